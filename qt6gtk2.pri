@@ -9,6 +9,9 @@ DEFINES += QT_DEPRECATED_WARNINGS QT_DISABLE_DEPRECATED_BEFORE=0x060000
 DEFINES += QT_NO_CAST_FROM_BYTEARRAY QT_STRICT_ITERATORS QT_NO_FOREACH QT_DEPRECATED_WARNINGS
 QMAKE_DISTCLEAN += -r .build
 
+QT6GTK2_VERSION = 0.3
+DEFINES += QT6GTK2_VERSION=\\\"$$QT6GTK2_VERSION\\\"
+
 #*-g++ {
 #  QMAKE_CXXFLAGS += -Werror=suggest-override
 #  QMAKE_CXXFLAGS += -Wzero-as-null-pointer-constant
@@ -21,4 +24,5 @@ QMAKE_DISTCLEAN += -r .build
 #Install paths
 unix {
   isEmpty(PLUGINDIR):PLUGINDIR = $$[QT_INSTALL_PLUGINS]
+  isEmpty(LIBEXECDIR):LIBEXECDIR = $$[QT_INSTALL_LIBEXECS]
 }
@@ -1,7 +1,10 @@
 TEMPLATE = subdirs
 
-SUBDIRS += src/qt6gtk2-qtplugin src/qt6gtk2-style
+SUBDIRS += src/qt6gtk2-qtplugin src/qt6gtk2-style src/qt6gtk2-helper
+
+CONFIG(tests): SUBDIRS += tests
 
 include(qt6gtk2.pri)
 
 message (PLUGINDIR=$$PLUGINDIR)
+message (LIBEXECDIR=$$LIBEXECDIR)
@@ -0,0 +1,243 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+// Renders theme elements for the qt6gtk2 style in a separate process, so
+// that several of them can be rendered in parallel and a crashing engine
+// does not take the application down. See qgtkhelperprotocol_p.h.
+
+#include <QByteArray>
+#include <QHash>
+#include <gtk/gtk.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "qgtkhelperprotocol_p.h"
+
+QT_USE_NAMESPACE
+
+static GtkWidget *proxyWindow = nullptr;
+static GtkWidget *proxyFixed = nullptr;
+static QHash<QByteArray, GtkWidget *> proxyWidgets;
+
+static bool readFully(void *data, size_t size)
+{
+    char *ptr = static_cast<char *>(data);
+    while (size > 0) {
+        const ssize_t count = read(STDIN_FILENO, ptr, size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        ptr += count;
+        size -= size_t(count);
+    }
+    return true;
+}
+
+static bool writeFully(const void *data, size_t size)
+{
+    const char *ptr = static_cast<const char *>(data);
+    while (size > 0) {
+        const ssize_t count = write(STDOUT_FILENO, ptr, size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        ptr += count;
+        size -= size_t(count);
+    }
+    return true;
+}
+
+static bool reply(quint32 id, qint32 status)
+{
+    const QGtkHelperReply message = { QGtkHelperMagic, id, status, QGtkHelperVersion };
+    return writeFully(&message, sizeof(message));
+}
+
+// Makes sure the types the style asks for are known by name
+static void registerTypes()
+{
+    g_type_class_unref(g_type_class_ref(gtk_button_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_toggle_button_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_check_button_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_radio_button_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_entry_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_spin_button_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_hscrollbar_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_vscrollbar_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_hscale_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_vscale_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_progress_bar_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_notebook_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_frame_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_toolbar_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_menu_bar_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_statusbar_get_type()));
+    g_type_class_unref(g_type_class_ref(gtk_handle_box_get_type()));
+}
+
+static GtkWidget *proxyWidget(const QByteArray &name)
+{
+    QHash<QByteArray, GtkWidget *>::const_iterator it = proxyWidgets.constFind(name);
+    if (it != proxyWidgets.constEnd())
+        return it.value();
+
+    GtkWidget *widget = nullptr;
+    const GType type = g_type_from_name(name.constData());
+    if (type && g_type_is_a(type, GTK_TYPE_WIDGET) && !G_TYPE_IS_ABSTRACT(type)
+            && !g_type_is_a(type, GTK_TYPE_WINDOW)) {
+        widget = GTK_WIDGET(g_object_new(type, nullptr));
+        gtk_container_add(GTK_CONTAINER(proxyFixed), widget);
+        gtk_widget_realize(widget);
+    }
+    proxyWidgets.insert(name, widget);
+    return widget;
+}
+
+static void draw(const QGtkHelperRequest &request, GtkWidget *widget, GdkPixmap *pixmap,
+                 GtkStyle *style, GdkRectangle *area)
+{
+    const GtkStateType state = GtkStateType(request.state);
+    const GtkShadowType shadow = GtkShadowType(request.shadow);
+    const gchar *detail = request.detail[0] ? request.detail : nullptr;
+    switch (request.element) {
+    case QGtkHelperBox:
+        gtk_paint_box(style, pixmap, state, shadow, area, widget, detail,
+                      area->x, area->y, area->width, area->height);
+        break;
+    case QGtkHelperBoxGap:
+        gtk_paint_box_gap(style, pixmap, state, shadow, area, widget, detail,
+                          area->x, area->y, area->width, area->height,
+                          GtkPositionType(request.params[0]), request.params[2], request.params[1]);
+        break;
+    case QGtkHelperSlider:
+        gtk_paint_slider(style, pixmap, state, shadow, area, widget, detail,
+                         area->x, area->y, area->width, area->height,
+                         GtkOrientation(request.params[0]));
+        break;
+    case QGtkHelperExtension:
+        gtk_paint_extension(style, pixmap, state, shadow, area, widget, detail,
+                            area->x, area->y, area->width, area->height,
+                            GtkPositionType(request.params[0]));
+        break;
+    default:
+        break;
+    }
+}
+
+// Draws on black and on white and recovers the alpha channel from the
+// difference, like the dual render mode of the style does
+static bool render(const QGtkHelperRequest &request, uchar *memory, size_t memorySize)
+{
+    const int width = request.width;
+    const int height = request.height;
+    if (width <= 0 || height <= 0 || request.offset > memorySize
+            || size_t(width) * size_t(height) * 4 > memorySize - request.offset)
+        return false;
+    GtkWidget *widget = proxyWidget(QByteArray(request.widget, int(strnlen(request.widget, sizeof(request.widget)))));
+    if (!widget)
+        return false;
+
+    GtkStyle *style = gtk_widget_get_style(widget);
+    const bool alpha = request.flags & QGtkHelperAlpha;
+    GdkColormap *colormap = gtk_widget_get_colormap(proxyWindow);
+    GdkPixmap *pixmap = gdk_pixmap_new(proxyWindow->window, width, height, -1);
+    GdkPixbuf *black = gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+    GdkPixbuf *white = alpha ? gdk_pixbuf_new(GDK_COLORSPACE_RGB, TRUE, 8, width, height) : nullptr;
+    bool ok = pixmap && black && (!alpha || white);
+    if (ok) {
+        GdkRectangle area = {0, 0, width, height};
+        gdk_draw_rectangle(pixmap, alpha ? style->black_gc : *style->bg_gc, true, 0, 0, width, height);
+        draw(request, widget, pixmap, style, &area);
+        gdk_pixbuf_get_from_drawable(black, pixmap, colormap, 0, 0, 0, 0, width, height);
+        if (alpha) {
+            gdk_draw_rectangle(pixmap, style->white_gc, true, 0, 0, width, height);
+            draw(request, widget, pixmap, style, &area);
+            gdk_pixbuf_get_from_drawable(white, pixmap, colormap, 0, 0, 0, 0, width, height);
+        }
+
+        const int blackStride = gdk_pixbuf_get_rowstride(black);
+        const int whiteStride = white ? gdk_pixbuf_get_rowstride(white) : 0;
+        const guchar *blackData = gdk_pixbuf_get_pixels(black);
+        const guchar *whiteData = white ? gdk_pixbuf_get_pixels(white) : nullptr;
+        quint32 *out = reinterpret_cast<quint32 *>(memory + request.offset);
+        for (int y = 0; y < height; ++y) {
+            const guchar *b = blackData + y * blackStride;
+            const guchar *w = whiteData ? whiteData + y * whiteStride : nullptr;
+            for (int x = 0; x < width; ++x, b += 4) {
+                int a = 255;
+                if (w) {
+                    a = qMax(qMax(b[0] - w[0], b[1] - w[1]), b[2] - w[2]) + 255;
+                    w += 4;
+                }
+                *out++ = (quint32(a) << 24) | (quint32(b[0]) << 16) | (quint32(b[1]) << 8) | b[2];
+            }
+        }
+    }
+    if (white)
+        g_object_unref(white);
+    if (black)
+        g_object_unref(black);
+    if (pixmap)
+        g_object_unref(pixmap);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (!gtk_init_check(&argc, &argv) || argc < 3)
+        return 1;
+
+    const size_t memorySize = size_t(strtoul(argv[2], nullptr, 10));
+    const int fd = shm_open(argv[1], O_RDWR, 0);
+    if (fd < 0)
+        return 1;
+    void *mapped = mmap(nullptr, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return 1;
+    uchar *memory = static_cast<uchar *>(mapped);
+
+    registerTypes();
+    proxyWindow = gtk_window_new(GTK_WINDOW_POPUP);
+    proxyFixed = gtk_fixed_new();
+    gtk_container_add(GTK_CONTAINER(proxyWindow), proxyFixed);
+    gtk_widget_realize(proxyWindow);
+    gtk_widget_realize(proxyFixed);
+
+    if (!reply(0, 0))
+        return 1;
+
+    QGtkHelperRequest request;
+    while (readFully(&request, sizeof(request))) {
+        if (request.magic != QGtkHelperMagic)
+            return 1;
+        request.detail[sizeof(request.detail) - 1] = '\0';
+        const bool ok = render(request, memory, memorySize);
+        gdk_flush();
+        if (!reply(request.id, ok ? 0 : 1))
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+include(../../qt6gtk2.pri)
+
+TEMPLATE = app
+TARGET = qt6gtk2-helper
+QT = core
+CONFIG += console link_pkgconfig
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../qt6gtk2-style
+
+HEADERS += ../qt6gtk2-style/qgtkhelperprotocol_p.h
+SOURCES += main.cpp
+
+PKGCONFIG += gtk+-2.0
+LIBS += -lrt
+
+target.path = $$LIBEXECDIR
+INSTALLS += target
@@ -27,84 +27,1021 @@
 // and takes care of converting all such calls into cached Qt pixmaps.
 
 #include "qgtkstyle_p_p.h"
-#include <private/qhexstring_p.h>
+#include "qgtkdiskcache_p.h"
+#include "qgtkhelperpool_p.h"
+#include "qgtkscratchpool_p.h"
+#include "qgtksharedcache_p.h"
+#include "qgtkstats_p.h"
+#include "qgtkshmpixmap_p.h"
+#include <private/qsimd_p.h>
 #include <QWidget>
-#include <QPixmapCache>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QLoggingCategory>
+#include <qdrawutil.h>
+#include <QtEndian>
 
 QT_BEGIN_NAMESPACE
 
-// To recover alpha we apply the gtk painting function two times to
-// white, and black window backgrounds. This can be used to
-// recover the premultiplied alpha channel
-QPixmap QGtk2Painter::renderTheme(uchar *bdata, uchar *wdata, const QRect &rect) const
+Q_LOGGING_CATEGORY(lcQGtkVerify, "qt6gtk2.verify")
+
+// The black and white renderings are converted in place to Qt byte
+// order. Swizzled kernels take gdk-pixbuf data in gtk byte order, the
+// others take native 32 bit X pixels which only lack the alpha channel.
+// When a white rendering is supplied, the alpha channel is recovered
+// from the difference between both of them.
+
+template <bool Swizzle>
+static void qt_gtk_render_theme_generic(uchar *bdata, const uchar *wdata, int count)
 {
-    const int bytecount = rect.width() * rect.height() * 4;
+    const int red = Swizzle ? GTK_RED : QT_RED;
+    const int green = Swizzle ? GTK_GREEN : QT_GREEN;
+    const int blue = Swizzle ? GTK_BLUE : QT_BLUE;
+    const int bytecount = count * 4;
     for (int index = 0; index < bytecount ; index += 4) {
-        uchar val = bdata[index + GTK_BLUE];
-        if (m_alpha) {
-            int alphaval = qMax(bdata[index + GTK_BLUE] - wdata[index + GTK_BLUE],
-                                bdata[index + GTK_GREEN] - wdata[index + GTK_GREEN]);
-            alphaval = qMax(alphaval, bdata[index + GTK_RED] - wdata[index + GTK_RED]) + 255;
+        uchar val = bdata[index + blue];
+        if (wdata) {
+            int alphaval = qMax(bdata[index + blue] - wdata[index + blue],
+                                bdata[index + green] - wdata[index + green]);
+            alphaval = qMax(alphaval, bdata[index + red] - wdata[index + red]) + 255;
             bdata[index + QT_ALPHA] = alphaval;
+        } else if (!Swizzle) {
+            bdata[index + QT_ALPHA] = 0xff;
+        }
+        if (Swizzle) {
+            bdata[index + QT_RED] = bdata[index + GTK_RED];
+            bdata[index + QT_GREEN] = bdata[index + GTK_GREEN];
+            bdata[index + QT_BLUE] = val;
         }
-        bdata[index + QT_RED] = bdata[index + GTK_RED];
-        bdata[index + QT_GREEN] = bdata[index + GTK_GREEN];
-        bdata[index + QT_BLUE] = val;
     }
-    QImage converted((const uchar*)bdata, rect.width(), rect.height(), m_alpha ?
-                     QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+}
+
+#if defined(__SSE2__)
+// Converts two pixels unpacked to 16 bit channels
+template <bool Swizzle>
+static inline __m128i qt_gtk_render_pixels_sse2(__m128i black, __m128i white)
+{
+    const __m128i colorMask = _mm_set_epi16(0, 0xff, 0xff, 0xff, 0, 0xff, 0xff, 0xff);
+    const __m128i alphaMask = _mm_set_epi16(0xff, 0, 0, 0, 0xff, 0, 0, 0);
+    const __m128i diff = _mm_sub_epi16(black, white);
+    // the maximum of the three color differences ends up in the first channel
+    __m128i max = _mm_max_epi16(diff, _mm_shufflehi_epi16(_mm_shufflelo_epi16(diff, _MM_SHUFFLE(3, 0, 2, 1)),
+                                                          _MM_SHUFFLE(3, 0, 2, 1)));
+    max = _mm_max_epi16(max, _mm_shufflehi_epi16(_mm_shufflelo_epi16(diff, _MM_SHUFFLE(3, 1, 0, 2)),
+                                                 _MM_SHUFFLE(3, 1, 0, 2)));
+    max = _mm_add_epi16(max, _mm_set1_epi16(255));
+    const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(max, _MM_SHUFFLE(0, 0, 0, 0)),
+                                              _MM_SHUFFLE(0, 0, 0, 0));
+    const __m128i color = Swizzle ? _mm_shufflehi_epi16(_mm_shufflelo_epi16(black, _MM_SHUFFLE(3, 0, 1, 2)),
+                                                        _MM_SHUFFLE(3, 0, 1, 2))
+                                  : black;
+    return _mm_or_si128(_mm_and_si128(color, colorMask), _mm_and_si128(alpha, alphaMask));
+}
+
+template <bool Swizzle>
+static void qt_gtk_render_theme_sse2(uchar *bdata, const uchar *wdata, int count)
+{
+    int i = 0;
+    if (wdata) {
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= count; i += 4) {
+            const __m128i black = _mm_loadu_si128((const __m128i *)(bdata + i * 4));
+            const __m128i white = _mm_loadu_si128((const __m128i *)(wdata + i * 4));
+            const __m128i lo = qt_gtk_render_pixels_sse2<Swizzle>(_mm_unpacklo_epi8(black, zero),
+                                                                  _mm_unpacklo_epi8(white, zero));
+            const __m128i hi = qt_gtk_render_pixels_sse2<Swizzle>(_mm_unpackhi_epi8(black, zero),
+                                                                  _mm_unpackhi_epi8(white, zero));
+            _mm_storeu_si128((__m128i *)(bdata + i * 4), _mm_packus_epi16(lo, hi));
+        }
+    } else if (Swizzle) {
+        const __m128i rbMask = _mm_set1_epi32(0x00ff00ff);
+        for (; i + 4 <= count; i += 4) {
+            const __m128i pixels = _mm_loadu_si128((const __m128i *)(bdata + i * 4));
+            const __m128i rb = _mm_and_si128(pixels, rbMask);
+            const __m128i swapped = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+            _mm_storeu_si128((__m128i *)(bdata + i * 4),
+                             _mm_or_si128(_mm_andnot_si128(rbMask, pixels), swapped));
+        }
+    } else {
+        const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+        for (; i + 4 <= count; i += 4) {
+            const __m128i pixels = _mm_loadu_si128((const __m128i *)(bdata + i * 4));
+            _mm_storeu_si128((__m128i *)(bdata + i * 4), _mm_or_si128(pixels, alphaMask));
+        }
+    }
+    qt_gtk_render_theme_generic<Swizzle>(bdata + i * 4, wdata ? wdata + i * 4 : nullptr, count - i);
+}
+#endif
+
+#if QT_COMPILER_SUPPORTS_HERE(AVX2)
+template <bool Swizzle>
+QT_FUNCTION_TARGET(AVX2)
+static inline __m256i qt_gtk_render_pixels_avx2(__m256i black, __m256i white)
+{
+    const __m256i colorMask = _mm256_set_epi16(0, 0xff, 0xff, 0xff, 0, 0xff, 0xff, 0xff,
+                                               0, 0xff, 0xff, 0xff, 0, 0xff, 0xff, 0xff);
+    const __m256i alphaMask = _mm256_set_epi16(0xff, 0, 0, 0, 0xff, 0, 0, 0,
+                                               0xff, 0, 0, 0, 0xff, 0, 0, 0);
+    const __m256i diff = _mm256_sub_epi16(black, white);
+    __m256i max = _mm256_max_epi16(diff, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(diff, _MM_SHUFFLE(3, 0, 2, 1)),
+                                                                _MM_SHUFFLE(3, 0, 2, 1)));
+    max = _mm256_max_epi16(max, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(diff, _MM_SHUFFLE(3, 1, 0, 2)),
+                                                       _MM_SHUFFLE(3, 1, 0, 2)));
+    max = _mm256_add_epi16(max, _mm256_set1_epi16(255));
+    const __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(max, _MM_SHUFFLE(0, 0, 0, 0)),
+                                                 _MM_SHUFFLE(0, 0, 0, 0));
+    const __m256i color = Swizzle ? _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(black, _MM_SHUFFLE(3, 0, 1, 2)),
+                                                           _MM_SHUFFLE(3, 0, 1, 2))
+                                  : black;
+    return _mm256_or_si256(_mm256_and_si256(color, colorMask), _mm256_and_si256(alpha, alphaMask));
+}
+
+template <bool Swizzle>
+QT_FUNCTION_TARGET(AVX2)
+static void qt_gtk_render_theme_avx2(uchar *bdata, const uchar *wdata, int count)
+{
+    int i = 0;
+    if (wdata) {
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 8 <= count; i += 8) {
+            const __m256i black = _mm256_loadu_si256((const __m256i *)(bdata + i * 4));
+            const __m256i white = _mm256_loadu_si256((const __m256i *)(wdata + i * 4));
+            // unpack and pack work within 128 bit lanes, so the pixel order is preserved
+            const __m256i lo = qt_gtk_render_pixels_avx2<Swizzle>(_mm256_unpacklo_epi8(black, zero),
+                                                                  _mm256_unpacklo_epi8(white, zero));
+            const __m256i hi = qt_gtk_render_pixels_avx2<Swizzle>(_mm256_unpackhi_epi8(black, zero),
+                                                                  _mm256_unpackhi_epi8(white, zero));
+            _mm256_storeu_si256((__m256i *)(bdata + i * 4), _mm256_packus_epi16(lo, hi));
+        }
+    } else if (Swizzle) {
+        const __m256i rbMask = _mm256_set1_epi32(0x00ff00ff);
+        for (; i + 8 <= count; i += 8) {
+            const __m256i pixels = _mm256_loadu_si256((const __m256i *)(bdata + i * 4));
+            const __m256i rb = _mm256_and_si256(pixels, rbMask);
+            const __m256i swapped = _mm256_or_si256(_mm256_slli_epi32(rb, 16), _mm256_srli_epi32(rb, 16));
+            _mm256_storeu_si256((__m256i *)(bdata + i * 4),
+                                _mm256_or_si256(_mm256_andnot_si256(rbMask, pixels), swapped));
+        }
+    } else {
+        const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+        for (; i + 8 <= count; i += 8) {
+            const __m256i pixels = _mm256_loadu_si256((const __m256i *)(bdata + i * 4));
+            _mm256_storeu_si256((__m256i *)(bdata + i * 4), _mm256_or_si256(pixels, alphaMask));
+        }
+    }
+    qt_gtk_render_theme_generic<Swizzle>(bdata + i * 4, wdata ? wdata + i * 4 : nullptr, count - i);
+}
+#endif
+
+#if defined(__ARM_NEON__) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+static inline uint8x8_t qt_gtk_alpha_neon(uint8x8_t b0, uint8x8_t b1, uint8x8_t b2,
+                                          uint8x8_t w0, uint8x8_t w1, uint8x8_t w2)
+{
+    int16x8_t max = vreinterpretq_s16_u16(vsubl_u8(b0, w0));
+    max = vmaxq_s16(max, vreinterpretq_s16_u16(vsubl_u8(b1, w1)));
+    max = vmaxq_s16(max, vreinterpretq_s16_u16(vsubl_u8(b2, w2)));
+    return vmovn_u16(vreinterpretq_u16_s16(vaddq_s16(max, vdupq_n_s16(255))));
+}
+
+template <bool Swizzle>
+static void qt_gtk_render_theme_neon(uchar *bdata, const uchar *wdata, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x4_t black = vld4q_u8(bdata + i * 4);
+        uint8x16x4_t result;
+        result.val[0] = Swizzle ? black.val[2] : black.val[0];
+        result.val[1] = black.val[1];
+        result.val[2] = Swizzle ? black.val[0] : black.val[2];
+        if (wdata) {
+            const uint8x16x4_t white = vld4q_u8(wdata + i * 4);
+            const uint8x8_t lo = qt_gtk_alpha_neon(vget_low_u8(black.val[0]), vget_low_u8(black.val[1]),
+                                                   vget_low_u8(black.val[2]), vget_low_u8(white.val[0]),
+                                                   vget_low_u8(white.val[1]), vget_low_u8(white.val[2]));
+            const uint8x8_t hi = qt_gtk_alpha_neon(vget_high_u8(black.val[0]), vget_high_u8(black.val[1]),
+                                                   vget_high_u8(black.val[2]), vget_high_u8(white.val[0]),
+                                                   vget_high_u8(white.val[1]), vget_high_u8(white.val[2]));
+            result.val[3] = vcombine_u8(lo, hi);
+        } else {
+            result.val[3] = Swizzle ? black.val[3] : vdupq_n_u8(0xff);
+        }
+        vst4q_u8(bdata + i * 4, result);
+    }
+    qt_gtk_render_theme_generic<Swizzle>(bdata + i * 4, wdata ? wdata + i * 4 : nullptr, count - i);
+}
+#endif
+
+template <bool Swizzle>
+static QGtkRenderThemeFunc qt_gtk_resolve_render_theme()
+{
+#if QT_COMPILER_SUPPORTS_HERE(AVX2)
+    if (qCpuHasFeature(AVX2))
+        return qt_gtk_render_theme_avx2<Swizzle>;
+#endif
+#if defined(__SSE2__)
+    return qt_gtk_render_theme_sse2<Swizzle>;
+#elif defined(__ARM_NEON__) && Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    return qt_gtk_render_theme_neon<Swizzle>;
+#else
+    return qt_gtk_render_theme_generic<Swizzle>;
+#endif
+}
+
+// Converts a scanline read back through a GdkPixbuf
+static void qt_gtk_render_theme(uchar *bdata, const uchar *wdata, int count)
+{
+    static const QGtkRenderThemeFunc renderThemeFunc = qt_gtk_resolve_render_theme<true>();
+    renderThemeFunc(bdata, wdata, count);
+}
+
+// Completes a scanline in native X byte order, e.g. from a shared memory pixmap
+static void qt_gtk_render_native(uchar *bdata, const uchar *wdata, int count)
+{
+    static const QGtkRenderThemeFunc renderNativeFunc = qt_gtk_resolve_render_theme<false>();
+    renderNativeFunc(bdata, wdata, count);
+}
 
-    if (m_hflipped || m_vflipped) {
-        return QPixmap::fromImage(converted.mirrored(m_hflipped, m_vflipped));
+QGtkRenderThemeFunc qt_gtk_render_theme_kernel(bool scalar)
+{
+    return scalar ? qt_gtk_render_theme_generic<true> : qt_gtk_resolve_render_theme<true>();
+}
+
+static QPixmap qt_gtk_to_pixmap(const QImage &image, bool hflipped, bool vflipped)
+{
+    if (hflipped || vflipped) {
+        return QPixmap::fromImage(image.mirrored(hflipped, vflipped));
     }
     // on raster graphicssystem we need to do a copy here, because
     // we intend to deallocate the qimage bits shortly after...
-    return QPixmap::fromImage(converted.copy());
+    return QPixmap::fromImage(image.copy());
 }
 
-// This macro is responsible for painting any GtkStyle painting function onto a QPixmap
-#define DRAW_TO_CACHE(draw_func)                                                                    \
+static void qt_gtk_clear_argb(GdkPixmap *pixmap, const QRect &rect)
+{
+    cairo_t *cr = gdk_cairo_create(pixmap);
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+    cairo_rectangle(cr, rect.x(), rect.y(), rect.width(), rect.height());
+    cairo_fill(cr);
+    cairo_destroy(cr);
+}
+
+static void qt_gtk_swap_bytes(uchar *data, int width, int height, int bytesPerLine)
+{
+    for (int y = 0; y < height; ++y) {
+        quint32 *line = reinterpret_cast<quint32 *>(data + y * bytesPerLine);
+        for (int x = 0; x < width; ++x)
+            line[x] = qbswap(line[x]);
+    }
+}
+
+// To recover alpha we apply the gtk painting function two times to
+// white, and black window backgrounds. This can be used to
+// recover the premultiplied alpha channel
+QPixmap QGtk2Painter::renderTheme(uchar *bdata, uchar *wdata, const QSize &size, int bytesPerLine) const
+{
+    for (int y = 0; y < size.height(); ++y) {
+        qt_gtk_render_theme(bdata + y * bytesPerLine, m_alpha && wdata ? wdata + y * bytesPerLine : nullptr,
+                            size.width());
+    }
+
+    QImage converted((const uchar*)bdata, size.width(), size.height(), bytesPerLine, m_alpha ?
+                     QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    return qt_gtk_to_pixmap(converted, m_hflipped, m_vflipped);
+}
+
+QPixmap QGtk2Painter::renderToPixmap(const QSize &size, GtkStyle *style, const DrawFunc &draw) const
+{
+    // Without alpha a single pass on the background color is enough
+    QGtkStatsTimer timer(QGtkStats::Render);
+    QPixmap cache;
+    if (m_alpha && m_renderMode == ArgbRender && m_argbWindow)
+        cache = renderSurface(m_argbWindow, size, style, draw, true);
+    if (cache.isNull())
+        cache = renderSurface(m_window, size, style, draw, false);
+    return cache;
+}
+
+// Elements are remembered as opaque per size, since an engine may draw
+// rounded corners only at some sizes. Stretched nine-patches are keyed by
+// their canonical size, so the verdict carries over to every painted size.
+// Flipping does not change what the engine draws over the background.
+static QGtkPixmapKey qt_gtk_opacity_key(const QGtkPixmapKey &key)
+{
+    QGtkPixmapKey opacityKey = key;
+    opacityKey.flags = 0;
+    return opacityKey;
+}
+
+static bool qt_gtk_is_opaque(const QImage &image)
+{
+    if (!image.hasAlphaChannel())
+        return true;
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            if (qAlpha(line[x]) != 255)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Renders the element identified by key. Recovering alpha from the black
+// and the white pass doubles the work of the engine, so once an element
+// came out fully opaque it is drawn in a single pass on the background
+// until the theme changes.
+QPixmap QGtk2Painter::renderElement(const QGtkPixmapKey &key, const QSize &size, GtkStyle *style,
+                                    const DrawFunc &draw)
+{
+    const bool dualAlpha = m_alpha && !(m_renderMode == ArgbRender && m_argbWindow);
+    if (!dualAlpha)
+        return renderToPixmap(size, style, draw);
+
+    const QGtkPixmapKey opacityKey = qt_gtk_opacity_key(key);
+    if (m_opaque.contains(opacityKey)) {
+        m_alpha = false;
+        const QPixmap cache = renderToPixmap(size, style, draw);
+        m_alpha = true;
+        return cache;
+    }
+    const QPixmap cache = renderToPixmap(size, style, draw);
+    if (!cache.isNull() && qt_gtk_is_opaque(cache.toImage()))
+        m_opaque.insert(opacityKey);
+    return cache;
+}
+
+QPixmap QGtk2Painter::renderSurface(GtkWidget *window, const QSize &size, GtkStyle *style,
+                                    const DrawFunc &draw, bool argb) const
+{
+    QGtkScratchSurface *surface = m_scratchPool->acquire(window, size);
+    if (!surface)
+        return QPixmap();
+    style = m_scratchPool->attachStyle(window, style);
+
+    QPixmap cache;
+    if (surface->shm)
+        cache = renderShm(surface->shm, size, style, draw, argb);
+    else if (argb)
+        cache = renderArgb(surface, size, style, draw);
+    else
+        cache = renderDual(surface, size, style, draw);
+    m_scratchPool->release(surface);
+    return cache;
+}
+
+// The engine draws into shared memory, so the pixels are read
+// directly into the image instead of going through a GdkPixbuf.
+QPixmap QGtk2Painter::renderShm(QGtkShmPixmap *target, const QSize &size, GtkStyle *style,
+                                const DrawFunc &draw, bool argb) const
+{
+    const int width = size.width();
+    const int height = size.height();
+    GdkPixmap *pixmap = target->pixmap();
+    GdkRectangle area = {0, 0, width, height};
+    if (argb)
+        qt_gtk_clear_argb(pixmap, QRect(QPoint(0, 0), size));
+    else
+        gdk_draw_rectangle(pixmap, m_alpha ? style->black_gc : *style->bg_gc, true, 0, 0, width, height);
+    draw(pixmap, style, &area);
+    {
+        QGtkStatsTimer timer(QGtkStats::ReadBack);
+        target->sync();
+    }
+
+    QImage image(size, m_alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+    if (image.isNull())
+        return QPixmap();
+    for (int y = 0; y < height; ++y)
+        memcpy(image.scanLine(y), target->constScanLine(y), width * 4);
+
+    if (!m_alpha) {
+        // the padding byte of the X pixels is undefined
+        for (int y = 0; y < height; ++y)
+            qt_gtk_render_native(image.scanLine(y), nullptr, width);
+    } else if (!argb) {
+        gdk_draw_rectangle(pixmap, style->white_gc, true, 0, 0, width, height);
+        draw(pixmap, style, &area);
+        QGtkStatsTimer timer(QGtkStats::ReadBack);
+        target->sync();
+        for (int y = 0; y < height; ++y)
+            qt_gtk_render_native(image.scanLine(y), target->constScanLine(y), width);
+    }
+
+    if (m_hflipped || m_vflipped)
+        return QPixmap::fromImage(image.mirrored(m_hflipped, m_vflipped));
+    return QPixmap::fromImage(std::move(image));
+}
+
+QPixmap QGtk2Painter::renderDual(QGtkScratchSurface *surface, const QSize &size, GtkStyle *style,
+                                 const DrawFunc &draw) const
+{
+    const int width = size.width();
+    const int height = size.height();
+    GdkPixmap *pixmap = surface->pixmap;
+    GdkRectangle area = {0, 0, width, height};
+    gdk_draw_rectangle(pixmap, m_alpha ? style->black_gc : *style->bg_gc, true, 0, 0, width, height);
+    draw(pixmap, style, &area);
+
+    GdkPixbuf *imgb = surface->pixbuf(0);
+    if (!imgb)
+        return QPixmap();
+    {
+        QGtkStatsTimer timer(QGtkStats::ReadBack);
+        gdk_pixbuf_get_from_drawable(imgb, pixmap, nullptr, 0, 0, 0, 0, width, height);
+    }
+    uchar* bdata = (uchar*)gdk_pixbuf_get_pixels(imgb);
+    const int bytesPerLine = gdk_pixbuf_get_rowstride(imgb);
+    if (!m_alpha)
+        return renderTheme(bdata, nullptr, size, bytesPerLine);
+
+    gdk_draw_rectangle(pixmap, style->white_gc, true, 0, 0, width, height);
+    draw(pixmap, style, &area);
+    GdkPixbuf *imgw = surface->pixbuf(1);
+    if (!imgw)
+        return QPixmap();
+    {
+        QGtkStatsTimer timer(QGtkStats::ReadBack);
+        gdk_pixbuf_get_from_drawable(imgw, pixmap, nullptr, 0, 0, 0, 0, width, height);
+    }
+    uchar* wdata = (uchar*)gdk_pixbuf_get_pixels(imgw);
+    return renderTheme(bdata, wdata, size, bytesPerLine);
+}
+
+// The pixmap shares the 32 bit visual of m_argbWindow, so the theme engine
+// draws a single time onto a transparent background and the premultiplied
+// alpha channel is read back directly.
+QPixmap QGtk2Painter::renderArgb(QGtkScratchSurface *surface, const QSize &size, GtkStyle *style,
+                                 const DrawFunc &draw) const
+{
+    const int width = size.width();
+    const int height = size.height();
+    GdkPixmap *pixmap = surface->pixmap;
+    GdkRectangle area = {0, 0, width, height};
+    qt_gtk_clear_argb(pixmap, QRect(QPoint(0, 0), size));
+    draw(pixmap, style, &area);
+
+    GdkImage *image = surface->image();
+    if (!image || image->bpp != 4)
+        return QPixmap();
+    {
+        QGtkStatsTimer timer(QGtkStats::ReadBack);
+        gdk_drawable_copy_to_image(pixmap, image, 0, 0, 0, 0, width, height);
+    }
+
+    if (image->byte_order != ((Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? GDK_LSB_FIRST : GDK_MSB_FIRST))
+        qt_gtk_swap_bytes((uchar*)image->mem, width, height, image->bpl);
+    QImage converted((const uchar*)image->mem, width, height, image->bpl,
+                     QImage::Format_ARGB32_Premultiplied);
+    return qt_gtk_to_pixmap(converted, m_hflipped, m_vflipped);
+}
+
+enum {
+    batchAtlasSize = 1024,  // edge of the batch atlas
+    maxBatchCell   = 512,   // larger elements are rendered on their own
+    batchPadding   = 2      // free pixels between cells
+};
+
+// Cache misses within a batch are drawn right away into a shared atlas, so
+// that the engine still sees the current widget state. Only the readback
+// and the conversion are deferred until the batch ends.
+struct QGtkBatchAtlas
+{
+    struct Job
+    {
+        QGtkPixmapKey key;
+        QByteArray digest;  // for the disk cache
+        QRect cell;
+        bool alpha;
+        bool hflipped;
+        bool vflipped;
+    };
+
+    QRect allocate(const QSize &size)
+    {
+        if (cursor.x() + size.width() > batchAtlasSize) {
+            cursor = QPoint(0, cursor.y() + shelfHeight + batchPadding);
+            shelfHeight = 0;
+        }
+        if (cursor.y() + size.height() > batchAtlasSize)
+            return QRect();
+        const QRect cell(cursor, size);
+        cursor.rx() += size.width() + batchPadding;
+        shelfHeight = qMax(shelfHeight, size.height());
+        usedSize = usedSize.expandedTo(QSize(cell.right() + 1, cell.bottom() + 1));
+        return cell;
+    }
+
+    GtkWidget *window = nullptr;
+    bool argb = false;
+    QGtkScratchSurface *black = nullptr; // the only surface in argb mode
+    QGtkScratchSurface *white = nullptr;
+    QList<Job> jobs;
+    QPoint cursor;
+    int shelfHeight = 0;
+    QSize usedSize;
+};
+
+// Returns the key of an element in the caches shared with other processes,
+// computing it is wasted if none of them is used
+static QByteArray qt_gtk_digest(const QGtkPixmapKey &key, GtkStyle *style)
+{
+    static const bool used = QGtkDiskCache::isEnabled() || QGtkSharedCache::isEnabled();
+    return used ? QGtkDiskCache::digest(key, style) : QByteArray();
+}
+
+static bool qt_gtk_find_persistent(const QByteArray &digest, QPixmap *pixmap)
+{
+    if (digest.isEmpty())
+        return false;
+    if (QGtkSharedCache::find(digest, pixmap))
+        return true;
+    if (!QGtkDiskCache::find(digest, pixmap))
+        return false;
+    QGtkSharedCache::insert(digest, pixmap->toImage());
+    return true;
+}
+
+static void qt_gtk_insert_persistent(const QByteArray &digest, const QImage &image)
+{
+    QGtkSharedCache::insert(digest, image);
+    QGtkDiskCache::insert(digest, image);
+}
+
+void QGtk2Painter::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+void QGtk2Painter::endBatch()
+{
+    if (m_batchDepth > 0 && --m_batchDepth == 0) {
+        if (QGtkHelperPool *helpers = QGtkHelperPool::instance()) {
+            helpers->collect([](const QGtkPixmapKey &key, const QByteArray &digest, const QImage &image) {
+                qt_gtk_insert_persistent(digest, image);
+                QGtkPixmapCache::insert(key, QPixmap::fromImage(image));
+            });
+        }
+        flushBatch(m_dualAtlas);
+        flushBatch(m_argbAtlas);
+        m_batchKeys.clear();
+    }
+}
+
+bool QGtk2Painter::queueBatchJob(const QGtkPixmapKey &key, const QByteArray &digest, const QSize &size,
+                                 GtkWidget *gtkWidget, GtkStyle *style, const DrawFunc &draw)
+{
+    if (m_batchKeys.contains(key))
+        return true;
+    QGtkHelperPool *helpers = QGtkHelperPool::instance();
+    if (helpers && helpers->submit(key, digest, gtkWidget, style)) {
+        m_batchKeys.insert(key);
+        return true;
+    }
+    if (size.width() > maxBatchCell || size.height() > maxBatchCell)
+        return false;
+
+    const bool argb = m_alpha && m_renderMode == ArgbRender && m_argbWindow;
+    const bool dualAlpha = m_alpha && !argb && !m_opaque.contains(qt_gtk_opacity_key(key));
+    QGtkBatchAtlas *atlas = argb ? m_argbAtlas : m_dualAtlas;
+    QRect cell = atlas->allocate(size);
+    if (!cell.isValid()) {
+        flushBatch(atlas);
+        cell = atlas->allocate(size);
+    }
+
+    const QSize atlasSize(batchAtlasSize, batchAtlasSize);
+    if (!atlas->black) {
+        atlas->window = argb ? m_argbWindow : m_window;
+        atlas->argb = argb;
+        atlas->black = m_scratchPool->acquire(atlas->window, atlasSize);
+    }
+    if (dualAlpha && atlas->black && !atlas->white)
+        atlas->white = m_scratchPool->acquire(atlas->window, atlasSize);
+    if (!atlas->black || (dualAlpha && !atlas->white)) {
+        discardBatch(atlas);
+        return false;
+    }
+
+    style = m_scratchPool->attachStyle(atlas->window, style);
+    GdkRectangle area = {cell.x(), cell.y(), cell.width(), cell.height()};
+    if (argb) {
+        qt_gtk_clear_argb(atlas->black->pixmap, cell);
+    } else {
+        gdk_draw_rectangle(atlas->black->pixmap, dualAlpha ? style->black_gc : *style->bg_gc, true,
+                           cell.x(), cell.y(), cell.width(), cell.height());
+    }
+    draw(atlas->black->pixmap, style, &area);
+    if (dualAlpha) {
+        gdk_draw_rectangle(atlas->white->pixmap, style->white_gc, true,
+                           cell.x(), cell.y(), cell.width(), cell.height());
+        draw(atlas->white->pixmap, style, &area);
+    }
+
+    atlas->jobs.append({ key, digest, cell, argb || dualAlpha, m_hflipped, m_vflipped });
+    m_batchKeys.insert(key);
+    return true;
+}
+
+// Reads the used part of an atlas surface in a single transfer. The
+// returned image is in Qt byte order, but its alpha channel is not set.
+QImage QGtk2Painter::readBatchSurface(QGtkScratchSurface *surface, const QSize &size, bool argb) const
+{
+    if (surface->shm) {
+        surface->shm->sync();
+        return QImage(surface->shm->constScanLine(0), size.width(), size.height(),
+                      surface->shm->bytesPerLine(), QImage::Format_ARGB32_Premultiplied);
+    }
+
+    if (argb) {
+        GdkImage *image = surface->image();
+        if (!image || image->bpp != 4)
+            return QImage();
+        gdk_drawable_copy_to_image(surface->pixmap, image, 0, 0, 0, 0, size.width(), size.height());
+        if (image->byte_order != ((Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? GDK_LSB_FIRST : GDK_MSB_FIRST))
+            qt_gtk_swap_bytes((uchar*)image->mem, size.width(), size.height(), image->bpl);
+        return QImage((const uchar*)image->mem, size.width(), size.height(), image->bpl,
+                      QImage::Format_ARGB32_Premultiplied);
+    }
+
+    GdkPixbuf *pixbuf = surface->pixbuf(0);
+    if (!pixbuf)
+        return QImage();
+    gdk_pixbuf_get_from_drawable(pixbuf, surface->pixmap, nullptr, 0, 0, 0, 0, size.width(), size.height());
+    uchar *data = (uchar*)gdk_pixbuf_get_pixels(pixbuf);
+    const int bytesPerLine = gdk_pixbuf_get_rowstride(pixbuf);
+    for (int y = 0; y < size.height(); ++y)
+        qt_gtk_render_theme(data + y * bytesPerLine, nullptr, size.width());
+    return QImage((const uchar*)data, size.width(), size.height(), bytesPerLine,
+                  QImage::Format_ARGB32_Premultiplied);
+}
+
+void QGtk2Painter::flushBatch(QGtkBatchAtlas *atlas)
+{
+    if (!atlas->jobs.isEmpty()) {
+        QGtkStatsTimer timer(QGtkStats::ReadBack);
+        const QImage black = readBatchSurface(atlas->black, atlas->usedSize, atlas->argb);
+        const QImage white = atlas->white ? readBatchSurface(atlas->white, atlas->usedSize, false) : QImage();
+        for (const QGtkBatchAtlas::Job &job : qAsConst(atlas->jobs)) {
+            const QRect &cell = job.cell;
+            if (black.isNull() || (job.alpha && !atlas->argb && white.isNull()))
+                break;
+            QImage image(cell.size(), job.alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+            for (int y = 0; y < cell.height(); ++y) {
+                uchar *line = image.scanLine(y);
+                memcpy(line, black.constScanLine(cell.y() + y) + cell.x() * 4, cell.width() * 4);
+                if (!job.alpha)
+                    qt_gtk_render_native(line, nullptr, cell.width());
+                else if (!atlas->argb)
+                    qt_gtk_render_native(line, white.constScanLine(cell.y() + y) + cell.x() * 4, cell.width());
+            }
+            if (job.alpha && !atlas->argb && qt_gtk_is_opaque(image))
+                m_opaque.insert(qt_gtk_opacity_key(job.key));
+            if (job.hflipped || job.vflipped)
+                image = image.mirrored(job.hflipped, job.vflipped);
+            qt_gtk_insert_persistent(job.digest, image);
+            QGtkPixmapCache::insert(job.key, QPixmap::fromImage(std::move(image)));
+        }
+    }
+    discardBatch(atlas);
+}
+
+// Drops the surfaces and jobs of an atlas. Keys of jobs that did not
+// make it into the cache can be queued again.
+void QGtk2Painter::discardBatch(QGtkBatchAtlas *atlas)
+{
+    for (const QGtkBatchAtlas::Job &job : qAsConst(atlas->jobs))
+        m_batchKeys.remove(job.key);
+    if (atlas->black)
+        m_scratchPool->release(atlas->black);
+    if (atlas->white)
+        m_scratchPool->release(atlas->white);
+    *atlas = QGtkBatchAtlas();
+}
+
+enum {
+    speculationBudget = 2,  // ms of speculative rendering per event loop pass
+    maxSpeculative    = 32  // queued speculative renders
+};
+
+// Whether a proxy widget is in the state it has between paints. The style
+// sets focus, the window default and the text direction only while it
+// paints a particular control.
+static bool qt_gtk_is_resting(GtkWidget *gtkWidget)
+{
+    return !gtkWidget || (!GTK_WIDGET_HAS_FOCUS(gtkWidget) && !GTK_WIDGET_HAS_DEFAULT(gtkWidget)
+                          && gtk_widget_get_direction(gtkWidget) == gtk_widget_get_default_direction());
+}
+
+// Queues the hover and pressed variants of an element that was just
+// rendered in its normal state, so that the first hover or press does not
+// have to wait for the engine. The variants are drawn later against the
+// resting gtk widget, so elements painted with any per-paint widget state
+// are skipped. That includes a non-zero key extra, which carries state
+// such as the default button bit.
+void QGtk2Painter::speculate(const QGtkPixmapKey &key, GtkShadowType pressedShadow, GtkWidget *gtkWidget,
+                             GtkStyle *style, const VariantFunc &variant)
+{
+    static const bool disabled = qEnvironmentVariableIsSet("QT6GTK2_NO_SPECULATION");
+    if (disabled || !m_usePixmapCache || key.extra != 0 || !qt_gtk_is_resting(gtkWidget))
+        return;
+
+    const struct { GtkStateType state; GtkShadowType shadow; } variants[] = {
+        { GTK_STATE_PRELIGHT, GtkShadowType(key.shadow) },
+        { GTK_STATE_ACTIVE, pressedShadow }
+    };
+    for (const auto &v : variants) {
+        if (m_speculative.size() >= maxSpeculative)
+            break;
+        QGtkPixmapKey variantKey = key;
+        variantKey.state = quint8(v.state);
+        variantKey.shadow = quint8(v.shadow);
+        if (m_speculativeKeys.contains(variantKey) || QGtkPixmapCache::find(variantKey, nullptr))
+            continue;
+        m_speculative.append({ variantKey, gtkWidget, style, variant(v.state, v.shadow) });
+        m_speculativeKeys.insert(variantKey);
+    }
+
+    if (!m_speculationScheduled && !m_speculative.isEmpty()) {
+        m_speculationScheduled = true;
+        QTimer::singleShot(0, [this]() { runSpeculation(); });
+    }
+}
+
+void QGtk2Painter::runSpeculation()
+{
+    m_speculationScheduled = false;
+    const bool alpha = m_alpha;
+    const bool hflipped = m_hflipped;
+    const bool vflipped = m_vflipped;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_speculative.isEmpty() && timer.elapsed() < speculationBudget) {
+        const SpeculativeJob job = m_speculative.takeFirst();
+        m_speculativeKeys.remove(job.key);
+        QPixmap cache;
+        if (QGtkPixmapCache::find(job.key, &cache))
+            continue;
+        // Another paint may have left the widget in a different state
+        if (!qt_gtk_is_resting(job.widget))
+            continue;
+        const QByteArray digest = qt_gtk_digest(job.key, job.style);
+        if (!qt_gtk_find_persistent(digest, &cache)) {
+            m_alpha = job.key.flags & QGtkPixmapKey::Alpha;
+            m_hflipped = job.key.flags & QGtkPixmapKey::FlipHorizontal;
+            m_vflipped = job.key.flags & QGtkPixmapKey::FlipVertical;
+            cache = renderElement(job.key, QSize(job.key.width, job.key.height), job.style, job.draw);
+            if (cache.isNull())
+                continue;
+            if (!digest.isEmpty())
+                qt_gtk_insert_persistent(digest, cache.toImage());
+        }
+        QGtkPixmapCache::insert(job.key, cache);
+    }
+
+    m_alpha = alpha;
+    m_hflipped = hflipped;
+    m_vflipped = vflipped;
+    if (!m_speculative.isEmpty()) {
+        m_speculationScheduled = true;
+        QTimer::singleShot(0, [this]() { runSpeculation(); });
+    }
+}
+
+// This macro is responsible for rendering a DrawFunc onto a QPixmap.
+// Misses are served from the shared or disk cache if possible. Inside a batch,
+// misses are only queued and nothing is painted.
+#define RENDER_TO_CACHE(draw)                                                                       \
     if (rect.width() > QWIDGETSIZE_MAX || rect.height() > QWIDGETSIZE_MAX)                          \
         return;                                                                                     \
-    QRect pixmapRect(0, 0, rect.width(), rect.height());                                            \
     {                                                                                               \
-        GdkPixmap *pixmap = gdk_pixmap_new((GdkDrawable*)(m_window->window),   \
-                                                                rect.width(), rect.height(), -1);   \
-        if (!pixmap)                                                                                \
-            return;                                                                                 \
-        style = gtk_style_attach (style, m_window->window);                       \
-        gdk_draw_rectangle(pixmap, m_alpha ? style->black_gc : *style->bg_gc,  \
-                                                true, 0, 0, rect.width(), rect.height());           \
-        draw_func;                                                                                  \
-        GdkPixbuf *imgb = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8,             \
-                                                           rect.width(), rect.height());            \
-        if (!imgb)                                                                                  \
-            return;                                                                                 \
-        imgb = gdk_pixbuf_get_from_drawable(imgb, pixmap, nullptr, 0, 0, 0, 0,    \
-                                                                 rect.width(), rect.height());      \
-        uchar* bdata = (uchar*)gdk_pixbuf_get_pixels(imgb);                       \
-        if (m_alpha) {                                                                              \
-            gdk_draw_rectangle(pixmap, style->white_gc, true, 0, 0,            \
-                                                    rect.width(), rect.height());                   \
-            draw_func;                                                                              \
-            GdkPixbuf *imgw = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8,         \
-                                                               rect.width(), rect.height());        \
-            if (!imgw)                                                                              \
+        const QByteArray digest = m_usePixmapCache ? qt_gtk_digest(key, style) : QByteArray();      \
+        if (!qt_gtk_find_persistent(digest, &cache)) {                                              \
+            if (m_batchDepth && m_usePixmapCache && queueBatchJob(key, digest, rect.size(), gtkWidget, style, draw)) \
                 return;                                                                             \
-            imgw = gdk_pixbuf_get_from_drawable(imgw, pixmap, nullptr, 0, 0, 0, 0,\
-                                                                     rect.width(), rect.height());  \
-            uchar* wdata = (uchar*)gdk_pixbuf_get_pixels(imgw);                   \
-            cache = renderTheme(bdata, wdata, rect);                                                \
-            g_object_unref(imgw);                                               \
-        } else {                                                                                    \
-            cache = renderTheme(bdata, nullptr, rect);                                                    \
+            cache = renderElement(key, rect.size(), style, draw);                                   \
+            if (cache.isNull())                                                                     \
+                return;                                                                             \
+            if (!digest.isEmpty())                                                                  \
+                qt_gtk_insert_persistent(digest, cache.toImage());                                  \
         }                                                                                           \
-        gdk_drawable_unref(pixmap);                                            \
-        g_object_unref(imgb);                                                   \
+        if (m_verify)                                                                               \
+            verify(key, rect.size(), cache, style, draw);                                           \
+    }
+
+// This macro is responsible for painting any GtkStyle painting function onto a QPixmap.
+#define DRAW_TO_CACHE(draw_func)                                                                    \
+    {                                                                                               \
+        const DrawFunc draw = [&](GdkPixmap *pixmap, GtkStyle *style, GdkRectangle *area) {         \
+            draw_func;                                                                              \
+        };                                                                                          \
+        RENDER_TO_CACHE(draw)                                                                       \
+    }
+
+QGtk2Painter::QGtk2Painter() : QGtkPainter(), m_window(QGtkStylePrivate::gtkWidget("GtkWindow")),
+    m_argbWindow(nullptr), m_renderMode(DualRender), m_scratchPool(new QGtkScratchPool),
+    m_dualAtlas(new QGtkBatchAtlas), m_argbAtlas(new QGtkBatchAtlas), m_batchDepth(0),
+    m_speculationScheduled(false), m_verify(qEnvironmentVariableIsSet("QT6GTK2_VERIFY"))
+{
+    if (qgetenv("QT6GTK2_RENDER_MODE") == "argb")
+        setRenderMode(ArgbRender);
+}
+
+QGtk2Painter::~QGtk2Painter()
+{
+    if (m_argbWindow)
+        gtk_widget_destroy(m_argbWindow);
+}
+
+void QGtk2Painter::setRenderMode(RenderMode mode)
+{
+    if (mode == ArgbRender && !m_argbWindow) {
+        GdkColormap *colormap = gdk_screen_get_rgba_colormap(gdk_screen_get_default());
+        if (!colormap) {
+            qWarning("QGtk2Painter: no ARGB visual available, falling back to dual rendering");
+            mode = DualRender;
+        } else {
+            m_argbWindow = gtk_window_new(GTK_WINDOW_POPUP);
+            gtk_widget_set_colormap(m_argbWindow, colormap);
+            gtk_widget_realize(m_argbWindow);
+        }
+    }
+    m_renderMode = mode;
+}
+
+void QGtk2Painter::themeChanged()
+{
+    // pending batch entries were drawn with the old theme
+    discardBatch(m_dualAtlas);
+    discardBatch(m_argbAtlas);
+    m_batchKeys.clear();
+    m_stretchable.clear();
+    m_opaque.clear();
+    m_speculative.clear();
+    m_speculativeKeys.clear();
+    m_verified.clear();
+    m_scratchPool->clear();
+    QGtkHelperPool::themeChanged();
+}
+
+// Returns the size an element is rendered at. Along the stretchable axes
+// anything larger than 2 * border + 1 is rendered at that size and drawn
+// as a nine-patch, so that the cache entry does not depend on the size.
+static QSize qt_gtk_nine_patch_size(const QSize &size, Qt::Orientations stretch, int border)
+{
+    const int canonical = 2 * border + 1;
+    QSize result = size;
+    if ((stretch & Qt::Horizontal) && size.width() > canonical)
+        result.setWidth(canonical);
+    if ((stretch & Qt::Vertical) && size.height() > canonical)
+        result.setHeight(canonical);
+    return result;
+}
+
+// Returns the size to render the element drawn by draw at for the given size.
+// Axes in forced are always stretched, the requested ones only if the theme
+// draws the element in a way that survives it. key identifies the element
+// apart from its size.
+QSize QGtk2Painter::ninePatchSize(const QGtkPixmapKey &key, const QSize &size, Qt::Orientations forced,
+                                  Qt::Orientations requested, int border, GtkStyle *style,
+                                  const DrawFunc &draw)
+{
+    const QSize forcedSize = qt_gtk_nine_patch_size(size, forced, border);
+    const QSize canonical = qt_gtk_nine_patch_size(size, forced | requested, border);
+    if (canonical == forcedSize)
+        return canonical;
+
+    QGtkPixmapKey probeKey = key;
+    probeKey.width = canonical.width();
+    probeKey.height = canonical.height();
+    QHash<QGtkPixmapKey, bool>::const_iterator it = m_stretchable.constFind(probeKey);
+    if (it == m_stretchable.constEnd()) {
+        Qt::Orientations probed;
+        if (canonical.width() != forcedSize.width())
+            probed |= Qt::Horizontal;
+        if (canonical.height() != forcedSize.height())
+            probed |= Qt::Vertical;
+        it = m_stretchable.insert(probeKey, isStretchable(canonical, probed, style, draw));
     }
+    return it.value() ? canonical : forcedSize;
+}
 
-QGtk2Painter::QGtk2Painter() : QGtkPainter(), m_window(QGtkStylePrivate::gtkWidget("GtkWindow"))
-{}
+// Renders the element at its canonical size and at a larger size along
+// the stretched axes and checks that the nine-patch of the first matches
+// the second. Gradients and pinstripes across the center fail this.
+bool QGtk2Painter::isStretchable(const QSize &canonical, Qt::Orientations stretch,
+                                 GtkStyle *style, const DrawFunc &draw) const
+{
+    QSize probeSize = canonical;
+    if (stretch & Qt::Horizontal)
+        probeSize.setWidth(2 * canonical.width() + 1);
+    if (stretch & Qt::Vertical)
+        probeSize.setHeight(2 * canonical.height() + 1);
+
+    const QPixmap small = renderToPixmap(canonical, style, draw);
+    const QPixmap large = renderToPixmap(probeSize, style, draw);
+    if (small.isNull() || large.isNull())
+        return false;
+
+    QImage stretched(probeSize, QImage::Format_ARGB32_Premultiplied);
+    stretched.fill(Qt::transparent);
+    QPainter painter(&stretched);
+    const int hborder = (stretch & Qt::Horizontal) ? canonical.width() / 2 : 0;
+    const int vborder = (stretch & Qt::Vertical) ? canonical.height() / 2 : 0;
+    qDrawBorderPixmap(&painter, stretched.rect(), QMargins(hborder, vborder, hborder, vborder), small);
+    painter.end();
+
+    return stretched == large.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+static void qt_gtk_draw_nine_patch(QPainter *painter, const QRect &paintRect, const QPixmap &cache)
+{
+    if (cache.size() == paintRect.size()) {
+        painter->drawPixmap(paintRect.topLeft(), cache);
+        return;
+    }
+    // The center row and column are one pixel wide, so stretching them
+    // is the same as tiling. Note: the side effect of this is that
+    // pinstripe patterns will get fuzzy
+    const int hborder = cache.width() < paintRect.width() ? cache.width() / 2 : 0;
+    const int vborder = cache.height() < paintRect.height() ? cache.height() / 2 : 0;
+    qDrawBorderPixmap(painter, paintRect, QMargins(hborder, vborder, hborder, vborder), cache);
+}
+
+void QGtk2Painter::drawNinePatch(const QRect &paintRect, const QPixmap &cache)
+{
+    qt_gtk_draw_nine_patch(m_painter, paintRect, cache);
+}
+
+// Renders the element once more at paintSize with the plain dual render
+// path and compares that to what is painted from cache, which may come
+// from any of the faster paths, the persistent caches or a nine-patch.
+// Each key and size is checked once per theme.
+void QGtk2Painter::verify(const QGtkPixmapKey &key, const QSize &paintSize, const QPixmap &cache,
+                          GtkStyle *style, const DrawFunc &draw)
+{
+    QGtkPixmapKey verifiedKey = key;
+    verifiedKey.width = paintSize.width();
+    verifiedKey.height = paintSize.height();
+    if (cache.isNull() || paintSize.isEmpty() || m_verified.contains(verifiedKey))
+        return;
+    m_verified.insert(verifiedKey);
+
+    QGtkScratchSurface *surface = m_scratchPool->acquire(m_window, paintSize);
+    if (!surface)
+        return;
+    const QImage reference = renderDual(surface, paintSize, m_scratchPool->attachStyle(m_window, style), draw)
+                                 .toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    m_scratchPool->release(surface);
+    if (reference.isNull())
+        return;
+
+    QImage painted(paintSize, QImage::Format_ARGB32_Premultiplied);
+    painted.fill(Qt::transparent);
+    QPainter painter(&painted);
+    qt_gtk_draw_nine_patch(&painter, painted.rect(), cache);
+    painter.end();
+
+    static const int tolerance = qEnvironmentVariableIsSet("QT6GTK2_VERIFY_TOLERANCE")
+                                     ? qEnvironmentVariableIntValue("QT6GTK2_VERIFY_TOLERANCE") : 2;
+    QImage diff(paintSize, QImage::Format_ARGB32);
+    int mismatches = 0;
+    int worst = 0;
+    for (int y = 0; y < paintSize.height(); ++y) {
+        const QRgb *a = reinterpret_cast<const QRgb *>(reference.constScanLine(y));
+        const QRgb *b = reinterpret_cast<const QRgb *>(painted.constScanLine(y));
+        QRgb *d = reinterpret_cast<QRgb *>(diff.scanLine(y));
+        for (int x = 0; x < paintSize.width(); ++x) {
+            const int delta = qMax(qMax(qAbs(qRed(a[x]) - qRed(b[x])), qAbs(qGreen(a[x]) - qGreen(b[x]))),
+                                   qMax(qAbs(qBlue(a[x]) - qBlue(b[x])), qAbs(qAlpha(a[x]) - qAlpha(b[x]))));
+            worst = qMax(worst, delta);
+            if (delta > tolerance) {
+                ++mismatches;
+                d[x] = qRgb(255, 0, 0);
+            } else {
+                d[x] = qRgb(delta * 32, delta * 32, delta * 32);
+            }
+        }
+    }
+    if (!mismatches)
+        return;
+
+    const char *detail = reinterpret_cast<const char *>(quintptr(key.detail));
+    qCWarning(lcQGtkVerify, "element %d detail %s state %d shadow %d %dx%d (cached %dx%d): "
+              "%d pixels differ from the reference, by up to %d",
+              key.element, detail ? detail : "-", key.state, key.shadow, paintSize.width(), paintSize.height(),
+              cache.width(), cache.height(), mismatches, worst);
+
+    static const QString directory = qEnvironmentVariable("QT6GTK2_VERIFY_DIR");
+    if (!directory.isEmpty()) {
+        static int counter = 0;
+        const QString base = QStringLiteral("%1/%2-%3-%4").arg(directory).arg(++counter)
+                                 .arg(key.element).arg(QLatin1String(detail ? detail : "none"));
+        reference.save(base + QLatin1String("-reference.png"));
+        painted.save(base + QLatin1String("-painted.png"));
+        diff.save(base + QLatin1String("-diff.png"));
+    }
+}
 
 // Note currently painted without alpha for performance reasons
 void QGtk2Painter::paintBoxGap(GtkWidget *gtkWidget, const gchar* part,
@@ -117,73 +1054,62 @@ void QGtk2Painter::paintBoxGap(GtkWidget *gtkWidget, const gchar* part,
         return;
 
     QPixmap cache;
-    QRect rect = paintRect;
 
     // To avoid exhausting cache on large tabframes we cheat a bit by
-    // tiling the center part.
+    // tiling the center part. The gap itself can only be stretched
+    // across its side.
 
     const int maxHeight = 256;
     const int border = 16;
-    if (rect.height() > maxHeight && (gap_side == GTK_POS_TOP || gap_side == GTK_POS_BOTTOM))
-        rect.setHeight(2 * border + 1);
-
-    QString pixmapName = uniqueName(QLS(part), state, shadow, rect.size(), gtkWidget)
-                         % HexString<uchar>(gap_side)
-                         % HexString<gint>(width)
-                         % HexString<gint>(x);
-
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
-        DRAW_TO_CACHE(gtk_paint_box_gap (style,
-                                           pixmap,
-                                           state,
-                                           shadow,
-                                           nullptr,
-                                           gtkWidget,
-                                           (const gchar*)part,
-                                           0, 0,
-                                           rect.width(),
-                                           rect.height(),
-                                           gap_side,
-                                           x,
-                                           width));
+    const bool horizontalGap = gap_side == GTK_POS_TOP || gap_side == GTK_POS_BOTTOM;
+    const Qt::Orientations ninePatch = m_ninePatch & (horizontalGap ? Qt::Vertical : Qt::Horizontal);
+    Qt::Orientations stretch;
+    if (paintRect.height() > maxHeight && horizontalGap)
+        stretch |= Qt::Vertical;
+    const auto paint = [&](GdkPixmap *pixmap, GtkStyle *style, GdkRectangle *area) {
+        gtk_paint_box_gap (style,
+                           pixmap,
+                           state,
+                           shadow,
+                           area,
+                           gtkWidget,
+                           (const gchar*)part,
+                           area->x, area->y,
+                           area->width,
+                           area->height,
+                           gap_side,
+                           x,
+                           width);
+    };
+    // wrapping a reference keeps cache hits free of allocations
+    const DrawFunc draw = std::cref(paint);
+
+    QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::BoxGap, part, state, shadow, QSize(), style, gtkWidget,
+                                  0, gap_side, width, x);
+    const QRect rect(paintRect.topLeft(), ninePatchSize(key, paintRect.size(), stretch, ninePatch,
+                                                        border, style, draw));
+    key.width = rect.width();
+    key.height = rect.height();
+
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
+        RENDER_TO_CACHE(draw)
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
-    }
-    if (rect.size() != paintRect.size()) {
-        // We assume we can stretch the middle tab part
-        // Note: the side effect of this is that pinstripe patterns will get fuzzy
-        const QSize size = cache.size();
-        // top part
-        m_painter->drawPixmap(QRect(paintRect.left(), paintRect.top(),
-                                    paintRect.width(), border), cache,
-                             QRect(0, 0, size.width(), border));
-
-        // tiled center part
-        QPixmap tilePart(cache.width(), 1);
-        QPainter scanLinePainter(&tilePart);
-        scanLinePainter.drawPixmap(QRect(0, 0, tilePart.width(), tilePart.height()), cache, QRect(0, border, size.width(), 1));
-        scanLinePainter.end();
-        m_painter->drawTiledPixmap(QRect(paintRect.left(), paintRect.top() + border,
-                                         paintRect.width(), paintRect.height() - 2*border), tilePart);
-
-        // bottom part
-        m_painter->drawPixmap(QRect(paintRect.left(), paintRect.top() + paintRect.height() - border,
-                                    paintRect.width(), border), cache,
-                             QRect(0, size.height() - border, size.width(), border));
-    } else
-        m_painter->drawPixmap(paintRect.topLeft(), cache);
+            QGtkPixmapCache::insert(key, cache);
+    }
+    if (m_verify && cache.size() != paintRect.size())
+        verify(key, paintRect.size(), cache, style, draw);
+    drawNinePatch(paintRect, cache);
 }
 
 void QGtk2Painter::paintBox(GtkWidget *gtkWidget, const gchar* part,
                            const QRect &paintRect, GtkStateType state,
                            GtkShadowType shadow, GtkStyle *style,
-                           const QString &pmKey)
+                           quint32 pmKey)
 {
     if (!paintRect.isValid())
         return;
 
     QPixmap cache;
-    QRect rect = paintRect;
 
     // To avoid exhausting cache on large tabframes we cheat a bit by
     // tiling the center part.
@@ -191,75 +1117,70 @@ void QGtk2Painter::paintBox(GtkWidget *gtkWidget, const gchar* part,
     const int maxHeight = 256;
     const int maxArea = 256*512;
     const int border = 32;
-    if (rect.height() > maxHeight && (rect.width()*rect.height() > maxArea))
-        rect.setHeight(2 * border + 1);
-
-    QString pixmapName = uniqueName(QLS(part), state, shadow,
-                                    rect.size(), gtkWidget) % pmKey;
-
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
-        DRAW_TO_CACHE(gtk_paint_box (style,
-                                           pixmap,
-                                           state,
-                                           shadow,
-                                           nullptr,
-                                           gtkWidget,
-                                           part,
-                                           0, 0,
-                                           rect.width(),
-                                           rect.height()));
+    Qt::Orientations stretch;
+    if (paintRect.height() > maxHeight && (paintRect.width()*paintRect.height() > maxArea))
+        stretch |= Qt::Vertical;
+
+    const VariantFunc variant = [gtkWidget, part](GtkStateType state, GtkShadowType shadow) -> DrawFunc {
+        return [=](GdkPixmap *pixmap, GtkStyle *style, GdkRectangle *area) {
+            gtk_paint_box (style,
+                           pixmap,
+                           state,
+                           shadow,
+                           area,
+                           gtkWidget,
+                           part,
+                           area->x, area->y,
+                           area->width,
+                           area->height);
+        };
+    };
+    // the variant is only created when the element is actually rendered
+    const auto paint = [&](GdkPixmap *pixmap, GtkStyle *style, GdkRectangle *area) {
+        variant(state, shadow)(pixmap, style, area);
+    };
+    const DrawFunc draw = std::cref(paint);
+
+    QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Box, part, state, shadow, QSize(), style, gtkWidget, pmKey);
+    const QRect rect(paintRect.topLeft(), ninePatchSize(key, paintRect.size(), stretch, m_ninePatch,
+                                                        border, style, draw));
+    key.width = rect.width();
+    key.height = rect.height();
+
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
+        RENDER_TO_CACHE(draw)
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
-    }
-    if (rect.size() != paintRect.size()) {
-        // We assume we can stretch the middle tab part
-        // Note: the side effect of this is that pinstripe patterns will get fuzzy
-        const QSize size = cache.size();
-        // top part
-        m_painter->drawPixmap(QRect(paintRect.left(), paintRect.top(),
-                                    paintRect.width(), border), cache,
-                              QRect(0, 0, size.width(), border));
-
-        // tiled center part
-        QPixmap tilePart(cache.width(), 1);
-        QPainter scanLinePainter(&tilePart);
-        scanLinePainter.drawPixmap(QRect(0, 0, tilePart.width(), tilePart.height()), cache, QRect(0, border, size.width(), 1));
-        scanLinePainter.end();
-        m_painter->drawTiledPixmap(QRect(paintRect.left(), paintRect.top() + border,
-                                         paintRect.width(), paintRect.height() - 2*border), tilePart);
-
-        // bottom part
-        m_painter->drawPixmap(QRect(paintRect.left(), paintRect.top() + paintRect.height() - border,
-                                    paintRect.width(), border), cache,
-                              QRect(0, size.height() - border, size.width(), border));
-    } else
-        m_painter->drawPixmap(paintRect.topLeft(), cache);
+            QGtkPixmapCache::insert(key, cache);
+        // buttons are drawn sunken while pressed
+        if (state == GTK_STATE_NORMAL && part && !strcmp(part, "button"))
+            speculate(key, shadow == GTK_SHADOW_OUT ? GTK_SHADOW_IN : shadow, gtkWidget, style, variant);
+    }
+    if (m_verify && cache.size() != paintRect.size())
+        verify(key, paintRect.size(), cache, style, draw);
+    drawNinePatch(paintRect, cache);
 }
 
 void QGtk2Painter::paintHline(GtkWidget *gtkWidget, const gchar* part,
                              const QRect &rect, GtkStateType state,
                              GtkStyle *style, int x1, int x2, int y,
-                             const QString &pmKey)
+                             quint32 pmKey)
 {
     if (!rect.isValid())
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, GTK_SHADOW_NONE, rect.size(), gtkWidget)
-                         % HexString<int>(x1)
-                         % HexString<int>(x2)
-                         % HexString<int>(y)
-                         % pmKey;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Hline, part, state, GTK_SHADOW_NONE, rect.size(), style, gtkWidget,
+                                        pmKey, x1, x2, y);
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_hline (style,
                                          pixmap,
                                          state,
-                                         nullptr,
+                                         area,
                                          gtkWidget,
                                          part,
-                                         x1, x2, y));
+                                         area->x + x1, area->x + x2, area->y + y));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
 
     m_painter->drawPixmap(rect.topLeft(), cache);
@@ -268,29 +1189,26 @@ void QGtk2Painter::paintHline(GtkWidget *gtkWidget, const gchar* part,
 void QGtk2Painter::paintVline(GtkWidget *gtkWidget, const gchar* part,
                              const QRect &rect, GtkStateType state,
                              GtkStyle *style, int y1, int y2, int x,
-                             const QString &pmKey)
+                             quint32 pmKey)
 {
     if (!rect.isValid())
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, GTK_SHADOW_NONE, rect.size(), gtkWidget)
-                        % HexString<int>(y1)
-                        % HexString<int>(y2)
-                        % HexString<int>(x)
-                        % pmKey;
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Vline, part, state, GTK_SHADOW_NONE, rect.size(), style, gtkWidget,
+                                        pmKey, y1, y2, x);
 
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_vline (style,
                                          pixmap,
                                          state,
-                                         nullptr,
+                                         area,
                                          gtkWidget,
                                          part,
-                                         y1, y2,
-                                         x));
+                                         area->y + y1, area->y + y2,
+                                         area->x + x));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
     m_painter->drawPixmap(rect.topLeft(), cache);
 }
@@ -299,25 +1217,24 @@ void QGtk2Painter::paintVline(GtkWidget *gtkWidget, const gchar* part,
 void QGtk2Painter::paintExpander(GtkWidget *gtkWidget,
                                 const gchar* part, const QRect &rect,
                                 GtkStateType state, GtkExpanderStyle expander_state,
-                                GtkStyle *style, const QString &pmKey)
+                                GtkStyle *style, quint32 pmKey)
 {
     if (!rect.isValid())
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, GTK_SHADOW_NONE, rect.size(), gtkWidget)
-                         % HexString<uchar>(expander_state)
-                         % pmKey;
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Expander, part, state, GTK_SHADOW_NONE, rect.size(), style, gtkWidget,
+                                        pmKey, expander_state);
 
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_expander (style, pixmap,
-                                            state, nullptr,
+                                            state, area,
                                             gtkWidget, part,
-                                            rect.width()/2,
-                                            rect.height()/2,
+                                            area->x + rect.width()/2,
+                                            area->y + rect.height()/2,
                                             expander_state));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
 
     m_painter->drawPixmap(rect.topLeft(), cache);
@@ -325,22 +1242,22 @@ void QGtk2Painter::paintExpander(GtkWidget *gtkWidget,
 
 void QGtk2Painter::paintFocus(GtkWidget *gtkWidget, const gchar* part,
                              const QRect &rect, GtkStateType state,
-                             GtkStyle *style, const QString &pmKey)
+                             GtkStyle *style, quint32 pmKey)
 {
     if (!rect.isValid())
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, GTK_SHADOW_NONE, rect.size(), gtkWidget) % pmKey;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
-        DRAW_TO_CACHE(gtk_paint_focus (style, pixmap, state, nullptr,
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Focus, part, state, GTK_SHADOW_NONE, rect.size(), style, gtkWidget, pmKey);
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
+        DRAW_TO_CACHE(gtk_paint_focus (style, pixmap, state, area,
                                          gtkWidget,
                                          part,
-                                         0, 0,
+                                         area->x, area->y,
                                          rect.width(),
                                          rect.height()));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
 
     m_painter->drawPixmap(rect.topLeft(), cache);
@@ -350,21 +1267,22 @@ void QGtk2Painter::paintFocus(GtkWidget *gtkWidget, const gchar* part,
 void QGtk2Painter::paintResizeGrip(GtkWidget *gtkWidget, const gchar* part,
                                   const QRect &rect, GtkStateType state,
                                   GtkShadowType shadow, GdkWindowEdge edge,
-                                  GtkStyle *style, const QString &pmKey)
+                                  GtkStyle *style, quint32 pmKey)
 {
     if (!rect.isValid())
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, shadow, rect.size(), gtkWidget) % pmKey;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::ResizeGrip, part, state, shadow, rect.size(), style, gtkWidget,
+                                        pmKey, edge);
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_resize_grip (style, pixmap, state,
-                                               nullptr, gtkWidget,
-                                               part, edge, 0, 0,
+                                               area, gtkWidget,
+                                               part, edge, area->x, area->y,
                                                rect.width(),
                                                rect.height()));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
 
     m_painter->drawPixmap(rect.topLeft(), cache);
@@ -374,31 +1292,29 @@ void QGtk2Painter::paintResizeGrip(GtkWidget *gtkWidget, const gchar* part,
 void QGtk2Painter::paintArrow(GtkWidget *gtkWidget, const gchar* part,
                              const QRect &arrowrect, GtkArrowType arrow_type,
                              GtkStateType state, GtkShadowType shadow,
-                             gboolean fill, GtkStyle *style, const QString &pmKey)
+                             gboolean fill, GtkStyle *style, quint32 pmKey)
 {
     QRect rect = m_cliprect.isValid() ? m_cliprect : arrowrect;
     if (!rect.isValid())
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, shadow, rect.size())
-                         % HexString<uchar>(arrow_type)
-                         % pmKey;
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Arrow, part, state, shadow, rect.size(), style, nullptr,
+                                        pmKey, arrow_type);
 
-    GdkRectangle gtkCliprect = {0, 0, rect.width(), rect.height()};
     int xOffset = m_cliprect.isValid() ? arrowrect.x() - m_cliprect.x() : 0;
     int yOffset = m_cliprect.isValid() ? arrowrect.y() - m_cliprect.y() : 0;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_arrow (style, pixmap, state, shadow,
-                                         &gtkCliprect,
+                                         area,
                                          gtkWidget,
                                          part,
                                          arrow_type, fill,
-                                         xOffset, yOffset,
+                                         area->x + xOffset, area->y + yOffset,
                                          arrowrect.width(),
                                          arrowrect.height()))
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
 
     m_painter->drawPixmap(rect.topLeft(), cache);
@@ -413,22 +1329,22 @@ void QGtk2Painter::paintHandle(GtkWidget *gtkWidget, const gchar* part, const QR
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, shadow, rect.size())
-                         % HexString<uchar>(orientation);
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Handle, part, state, shadow, rect.size(), style, nullptr,
+                                        0, orientation);
 
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_handle (style,
                                           pixmap,
                                           state,
                                           shadow,
-                                          nullptr,
+                                          area,
                                           gtkWidget,
-                                          part, 0, 0,
+                                          part, area->x, area->y,
                                           rect.width(),
                                           rect.height(),
                                           orientation));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
     m_painter->drawPixmap(rect.topLeft(), cache);
 }
@@ -437,27 +1353,37 @@ void QGtk2Painter::paintHandle(GtkWidget *gtkWidget, const gchar* part, const QR
 void QGtk2Painter::paintSlider(GtkWidget *gtkWidget, const gchar* part, const QRect &rect,
                               GtkStateType state, GtkShadowType shadow,
                               GtkStyle *style, GtkOrientation orientation,
-                              const QString &pmKey)
+                              quint32 pmKey)
 {
     if (!rect.isValid())
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, shadow, rect.size(), gtkWidget) % pmKey;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
-        DRAW_TO_CACHE(gtk_paint_slider (style,
-                                          pixmap,
-                                          state,
-                                          shadow,
-                                          nullptr,
-                                          gtkWidget,
-                                          part,
-                                          0, 0,
-                                          rect.width(),
-                                          rect.height(),
-                                          orientation));
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Slider, part, state, shadow, rect.size(), style, gtkWidget,
+                                        pmKey, orientation);
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
+        const VariantFunc variant = [gtkWidget, part, orientation](GtkStateType state,
+                                                                   GtkShadowType shadow) -> DrawFunc {
+            return [=](GdkPixmap *pixmap, GtkStyle *style, GdkRectangle *area) {
+                gtk_paint_slider (style,
+                                  pixmap,
+                                  state,
+                                  shadow,
+                                  area,
+                                  gtkWidget,
+                                  part,
+                                  area->x, area->y,
+                                  area->width,
+                                  area->height,
+                                  orientation);
+            };
+        };
+        const DrawFunc draw = variant(state, shadow);
+        RENDER_TO_CACHE(draw)
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
+        if (state == GTK_STATE_NORMAL)
+            speculate(key, shadow, gtkWidget, style, variant);
     }
     m_painter->drawPixmap(rect.topLeft(), cache);
 }
@@ -466,46 +1392,57 @@ void QGtk2Painter::paintSlider(GtkWidget *gtkWidget, const gchar* part, const QR
 void QGtk2Painter::paintShadow(GtkWidget *gtkWidget, const gchar* part,
                               const QRect &rect, GtkStateType state,
                               GtkShadowType shadow, GtkStyle *style,
-                              const QString &pmKey)
+                              quint32 pmKey)
 
 {
     if (!rect.isValid())
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, shadow, rect.size()) % pmKey;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
-        DRAW_TO_CACHE(gtk_paint_shadow(style, pixmap, state, shadow, nullptr,
-                                         gtkWidget, part, 0, 0, rect.width(), rect.height()));
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Shadow, part, state, shadow, rect.size(), style, nullptr, pmKey);
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
+        DRAW_TO_CACHE(gtk_paint_shadow(style, pixmap, state, shadow, area,
+                                         gtkWidget, part, area->x, area->y, rect.width(), rect.height()));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
     m_painter->drawPixmap(rect.topLeft(), cache);
 }
 
 void QGtk2Painter::paintFlatBox(GtkWidget *gtkWidget, const gchar* part,
-                               const QRect &rect, GtkStateType state,
+                               const QRect &paintRect, GtkStateType state,
                                GtkShadowType shadow, GtkStyle *style,
-                               const QString &pmKey)
+                               quint32 pmKey)
 {
-    if (!rect.isValid())
+    if (!paintRect.isValid())
         return;
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, shadow, rect.size()) % pmKey;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
-        DRAW_TO_CACHE(gtk_paint_flat_box (style,
-                                            pixmap,
-                                            state,
-                                            shadow,
-                                            nullptr,
-                                            gtkWidget,
-                                            part, 0, 0,
-                                            rect.width(),
-                                            rect.height()));
+    const int border = 16;
+    const auto paint = [&](GdkPixmap *pixmap, GtkStyle *style, GdkRectangle *area) {
+        gtk_paint_flat_box (style,
+                            pixmap,
+                            state,
+                            shadow,
+                            area,
+                            gtkWidget,
+                            part, area->x, area->y,
+                            area->width,
+                            area->height);
+    };
+    const DrawFunc draw = std::cref(paint);
+    QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::FlatBox, part, state, shadow, QSize(), style, nullptr, pmKey);
+    const QRect rect(paintRect.topLeft(), ninePatchSize(key, paintRect.size(), Qt::Orientations(), m_ninePatch,
+                                                        border, style, draw));
+    key.width = rect.width();
+    key.height = rect.height();
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
+        RENDER_TO_CACHE(draw)
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
-    m_painter->drawPixmap(rect.topLeft(), cache);
+    if (m_verify && cache.size() != paintRect.size())
+        verify(key, paintRect.size(), cache, style, draw);
+    drawNinePatch(paintRect, cache);
 }
 
 void QGtk2Painter::paintExtention(GtkWidget *gtkWidget,
@@ -517,18 +1454,18 @@ void QGtk2Painter::paintExtention(GtkWidget *gtkWidget,
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(QLS(part), state, shadow, rect.size(), gtkWidget)
-                         % HexString<uchar>(gap_pos);
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Extension, part, state, shadow, rect.size(), style, gtkWidget,
+                                        0, gap_pos);
 
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_extension (style, pixmap, state, shadow,
-                                             nullptr, gtkWidget,
-                                             (const gchar*)part, 0, 0,
+                                             area, gtkWidget,
+                                             (const gchar*)part, area->x, area->y,
                                              rect.width(),
                                              rect.height(),
                                              gap_pos));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
 
     m_painter->drawPixmap(rect.topLeft(), cache);
@@ -536,7 +1473,7 @@ void QGtk2Painter::paintExtention(GtkWidget *gtkWidget,
 
 void QGtk2Painter::paintOption(GtkWidget *gtkWidget, const QRect &radiorect,
                               GtkStateType state, GtkShadowType shadow,
-                              GtkStyle *style, const QString &detail)
+                              GtkStyle *style, const gchar *detail)
 
 {
     QRect rect = m_cliprect.isValid() ? m_cliprect : radiorect;
@@ -544,22 +1481,21 @@ void QGtk2Painter::paintOption(GtkWidget *gtkWidget, const QRect &radiorect,
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(detail, state, shadow, rect.size());
-    GdkRectangle gtkCliprect = {0, 0, rect.width(), rect.height()};
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Option, detail, state, shadow, rect.size(), style);
     int xOffset = m_cliprect.isValid() ? radiorect.x() - m_cliprect.x() : 0;
     int yOffset = m_cliprect.isValid() ? radiorect.y() - m_cliprect.y() : 0;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_option(style, pixmap,
                                          state, shadow,
-                                         &gtkCliprect,
+                                         area,
                                          gtkWidget,
-                                         detail.toLatin1().constData(),
-                                         xOffset, yOffset,
+                                         detail,
+                                         area->x + xOffset, area->y + yOffset,
                                          radiorect.width(),
                                          radiorect.height()));
 
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
 
     m_painter->drawPixmap(rect.topLeft(), cache);
@@ -567,7 +1503,7 @@ void QGtk2Painter::paintOption(GtkWidget *gtkWidget, const QRect &radiorect,
 
 void QGtk2Painter::paintCheckbox(GtkWidget *gtkWidget, const QRect &checkrect,
                                 GtkStateType state, GtkShadowType shadow,
-                                GtkStyle *style, const QString &detail)
+                                GtkStyle *style, const gchar *detail)
 
 {
     QRect rect = m_cliprect.isValid() ? m_cliprect : checkrect;
@@ -575,23 +1511,22 @@ void QGtk2Painter::paintCheckbox(GtkWidget *gtkWidget, const QRect &checkrect,
         return;
 
     QPixmap cache;
-    QString pixmapName = uniqueName(detail, state, shadow, rect.size());
-    GdkRectangle gtkCliprect = {0, 0, rect.width(), rect.height()};
+    const QGtkPixmapKey key = pixmapKey(QGtkPixmapKey::Check, detail, state, shadow, rect.size(), style);
     int xOffset = m_cliprect.isValid() ? checkrect.x() - m_cliprect.x() : 0;
     int yOffset = m_cliprect.isValid() ? checkrect.y() - m_cliprect.y() : 0;
-    if (!m_usePixmapCache || !QPixmapCache::find(pixmapName, &cache)) {
+    if (!m_usePixmapCache || !QGtkPixmapCache::find(key, &cache)) {
         DRAW_TO_CACHE(gtk_paint_check (style,
                                          pixmap,
                                          state,
                                          shadow,
-                                         &gtkCliprect,
+                                         area,
                                          gtkWidget,
-                                         detail.toLatin1().constData(),
-                                         xOffset, yOffset,
+                                         detail,
+                                         area->x + xOffset, area->y + yOffset,
                                          checkrect.width(),
                                          checkrect.height()));
         if (m_usePixmapCache)
-            QPixmapCache::insert(pixmapName, cache);
+            QGtkPixmapCache::insert(key, cache);
     }
 
     m_painter->drawPixmap(rect.topLeft(), cache);
@@ -35,49 +35,136 @@
 #include <QtGlobal>
 #if !defined(QT_NO_STYLE_GTK)
 
+#include <functional>
+#include <QHash>
+#include <QSet>
 #include "qgtkpainter_p.h"
 
 QT_BEGIN_NAMESPACE
 
+class QGtkScratchPool;
+struct QGtkBatchAtlas;
+class QGtkScratchSurface;
+class QGtkShmPixmap;
+
+typedef void (*QGtkRenderThemeFunc)(uchar *bdata, const uchar *wdata, int count);
+
+// Returns the scanline kernel renderTheme() recovers alpha with, either
+// the one picked for this CPU or the scalar one, for the benchmarks
+QGtkRenderThemeFunc qt_gtk_render_theme_kernel(bool scalar);
+
 class QGtk2Painter : public QGtkPainter
 {
 public:
+    enum RenderMode
+    {
+        DualRender, // render on black and white backgrounds to recover alpha
+        ArgbRender  // render once into a pixmap with an rgba colormap
+    };
+
     QGtk2Painter();
+    ~QGtk2Painter();
+
+    void setRenderMode(RenderMode mode);
+    RenderMode renderMode() const { return m_renderMode; }
+
+    void themeChanged() override;
+    void beginBatch() override;
+    void endBatch() override;
 
     void paintBoxGap(GtkWidget *gtkWidget, const gchar* part, const QRect &rect,
                      GtkStateType state, GtkShadowType shadow, GtkPositionType gap_side, gint x,
                      gint width, GtkStyle *style) override;
     void paintBox(GtkWidget *gtkWidget, const gchar* part,
                   const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style,
-                  const QString &pmKey = QString()) override;
+                  quint32 pmKey = 0) override;
     void paintHline(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkStyle *style,
-                    int x1, int x2, int y, const QString &pmKey = QString()) override;
+                    int x1, int x2, int y, quint32 pmKey = 0) override;
     void paintVline(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkStyle *style,
-                    int y1, int y2, int x, const QString &pmKey = QString()) override;
+                    int y1, int y2, int x, quint32 pmKey = 0) override;
     void paintExpander(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state,
-                       GtkExpanderStyle expander_state, GtkStyle *style, const QString &pmKey = QString()) override;
+                       GtkExpanderStyle expander_state, GtkStyle *style, quint32 pmKey = 0) override;
     void paintFocus(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkStyle *style,
-                    const QString &pmKey = QString()) override;
+                    quint32 pmKey = 0) override;
     void paintResizeGrip(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow,
-                         GdkWindowEdge edge, GtkStyle *style, const QString &pmKey = QString()) override;
+                         GdkWindowEdge edge, GtkStyle *style, quint32 pmKey = 0) override;
     void paintArrow(GtkWidget *gtkWidget, const gchar* part, const QRect &arrowrect, GtkArrowType arrow_type, GtkStateType state, GtkShadowType shadow,
-                    gboolean fill, GtkStyle *style, const QString &pmKey = QString()) override;
+                    gboolean fill, GtkStyle *style, quint32 pmKey = 0) override;
     void paintHandle(GtkWidget *gtkWidget, const gchar* part, const QRect &rect,
                      GtkStateType state, GtkShadowType shadow, GtkOrientation orientation, GtkStyle *style) override;
     void paintSlider(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow,
-                     GtkStyle *style, GtkOrientation orientation, const QString &pmKey = QString()) override;
+                     GtkStyle *style, GtkOrientation orientation, quint32 pmKey = 0) override;
     void paintShadow(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow,
-                     GtkStyle *style, const QString &pmKey = QString()) override;
-    void paintFlatBox(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const QString & = QString()) override;
+                     GtkStyle *style, quint32 pmKey = 0) override;
+    void paintFlatBox(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, quint32 pmKey = 0) override;
     void paintExtention(GtkWidget *gtkWidget, const gchar *part, const QRect &rect, GtkStateType state, GtkShadowType shadow,
                         GtkPositionType gap_pos, GtkStyle *style) override;
-    void paintOption(GtkWidget *gtkWidget, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const QString &detail) override;
-    void paintCheckbox(GtkWidget *gtkWidget, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const QString &detail) override;
+    void paintOption(GtkWidget *gtkWidget, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const gchar *detail) override;
+    void paintCheckbox(GtkWidget *gtkWidget, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const gchar *detail) override;
 
 private:
-    QPixmap renderTheme(uchar *bdata, uchar *wdata, const QRect &rect) const;
+    // Draws into pixmap at area, which also serves as the clip rectangle
+    typedef std::function<void (GdkPixmap *pixmap, GtkStyle *style, GdkRectangle *area)> DrawFunc;
+    // Returns a DrawFunc for the same element in another state
+    typedef std::function<DrawFunc (GtkStateType state, GtkShadowType shadow)> VariantFunc;
+
+    struct SpeculativeJob
+    {
+        QGtkPixmapKey key;
+        GtkWidget *widget;
+        GtkStyle *style;
+        DrawFunc draw;
+    };
+
+    QPixmap renderTheme(uchar *bdata, uchar *wdata, const QSize &size, int bytesPerLine) const;
+    QSize ninePatchSize(const QGtkPixmapKey &key, const QSize &size, Qt::Orientations forced,
+                        Qt::Orientations requested, int border, GtkStyle *style, const DrawFunc &draw);
+    bool isStretchable(const QSize &canonical, Qt::Orientations stretch, GtkStyle *style,
+                       const DrawFunc &draw) const;
+    void drawNinePatch(const QRect &paintRect, const QPixmap &cache);
+    void verify(const QGtkPixmapKey &key, const QSize &paintSize, const QPixmap &cache,
+                GtkStyle *style, const DrawFunc &draw);
+    QPixmap renderElement(const QGtkPixmapKey &key, const QSize &size, GtkStyle *style, const DrawFunc &draw);
+    QPixmap renderToPixmap(const QSize &size, GtkStyle *style, const DrawFunc &draw) const;
+    QPixmap renderSurface(GtkWidget *window, const QSize &size, GtkStyle *style,
+                          const DrawFunc &draw, bool argb) const;
+    QPixmap renderShm(QGtkShmPixmap *target, const QSize &size, GtkStyle *style,
+                      const DrawFunc &draw, bool argb) const;
+    QPixmap renderDual(QGtkScratchSurface *surface, const QSize &size, GtkStyle *style,
+                       const DrawFunc &draw) const;
+    QPixmap renderArgb(QGtkScratchSurface *surface, const QSize &size, GtkStyle *style,
+                       const DrawFunc &draw) const;
+
+    bool queueBatchJob(const QGtkPixmapKey &key, const QByteArray &digest, const QSize &size,
+                       GtkWidget *gtkWidget, GtkStyle *style, const DrawFunc &draw);
+    QImage readBatchSurface(QGtkScratchSurface *surface, const QSize &size, bool argb) const;
+    void flushBatch(QGtkBatchAtlas *atlas);
+    void discardBatch(QGtkBatchAtlas *atlas);
+    void speculate(const QGtkPixmapKey &key, GtkShadowType pressedShadow, GtkWidget *gtkWidget,
+                   GtkStyle *style, const VariantFunc &variant);
+    void runSpeculation();
 
     GtkWidget *m_window;
+    GtkWidget *m_argbWindow;
+    RenderMode m_renderMode;
+    // never freed, the painter outlives the X connection
+    QGtkScratchPool *m_scratchPool;
+    QGtkBatchAtlas *m_dualAtlas;
+    QGtkBatchAtlas *m_argbAtlas;
+    int m_batchDepth;
+    QSet<QGtkPixmapKey> m_batchKeys;
+    // stretch probe verdicts for the current theme
+    QHash<QGtkPixmapKey, bool> m_stretchable;
+    // elements without translucent pixels in the current theme, they are
+    // rendered in a single pass
+    QSet<QGtkPixmapKey> m_opaque;
+    // hover and pressed variants rendered from an idle timer
+    QList<SpeculativeJob> m_speculative;
+    QSet<QGtkPixmapKey> m_speculativeKeys;
+    bool m_speculationScheduled;
+    // QT6GTK2_VERIFY, keys and sizes already compared to the reference
+    bool m_verify;
+    QSet<QGtkPixmapKey> m_verified;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,420 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtkdiskcache_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringList>
+#include <algorithm>
+#include <string.h>
+#include "qgtkstyle_p_p.h"
+
+#ifndef QT6GTK2_VERSION
+#define QT6GTK2_VERSION "unknown"
+#endif
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    cacheFormatVersion = 2,
+    digestSize         = 16,               // md5
+    maxPendingBytes    = 8 * 1024 * 1024,  // new entries kept until they are written
+    maxFileSize        = 32 * 1024 * 1024
+};
+
+static const char qt_gtk_cache_magic[8] = { 'Q', 'T', 'G', 'T', 'K', '2', 'D', 'C' };
+
+// The file starts with the header, followed by the entries sorted by
+// digest and the pixel data. Everything is in host byte order.
+struct QGtkDiskCacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 count;
+    uchar identity[digestSize];
+};
+
+struct QGtkDiskCacheEntry
+{
+    uchar digest[digestSize];
+    quint64 offset;     // of the pixels, lines are 4 * width bytes
+    quint16 width;
+    quint16 height;
+    quint32 format;     // QImage::Format
+};
+
+Q_STATIC_ASSERT(sizeof(QGtkDiskCacheHeader) == 32);
+Q_STATIC_ASSERT(sizeof(QGtkDiskCacheEntry) == 32);
+
+class QGtkDiskCacheData
+{
+public:
+    QGtkDiskCacheData()
+        : enabled(!qEnvironmentVariableIsSet("QT6GTK2_NO_DISK_CACHE")),
+          opened(false), syncOnExit(false), map(nullptr), mapSize(0),
+          entries(nullptr), count(0), pendingBytes(0)
+    {}
+
+    bool enabled;
+    bool opened;
+    bool syncOnExit;
+    QByteArray identity;
+    QFile file;
+    uchar *map;
+    qint64 mapSize;
+    const QGtkDiskCacheEntry *entries;
+    quint32 count;
+    QHash<QByteArray, QImage> pending;
+    qint64 pendingBytes;
+};
+
+Q_GLOBAL_STATIC(QGtkDiskCacheData, qt_gtk_disk_cache)
+
+static inline void qt_gtk_add_data(QCryptographicHash &hash, const void *data, int size)
+{
+    hash.addData(QByteArray::fromRawData(static_cast<const char *>(data), size));
+}
+
+// Strings are prefixed with their length, so that the fields cannot run
+// into each other
+static void qt_gtk_add_string(QCryptographicHash &hash, const QByteArray &str)
+{
+    const qint32 size = str.size();
+    qt_gtk_add_data(hash, &size, sizeof(size));
+    hash.addData(str);
+}
+
+// The style pointer only means something in this process, so hash what
+// the engine draws with
+static void qt_gtk_add_style(QCryptographicHash &hash, GtkStyle *style)
+{
+    if (!style) {
+        qt_gtk_add_string(hash, QByteArray());
+        return;
+    }
+    qt_gtk_add_string(hash, QByteArray(G_OBJECT_TYPE_NAME(style)));
+    const GdkColor *palettes[] = { style->fg, style->bg, style->light, style->dark,
+                                   style->mid, style->text, style->base, style->text_aa };
+    for (const GdkColor *colors : palettes) {
+        for (int i = 0; i < 5; ++i) {
+            const quint16 rgb[3] = { colors[i].red, colors[i].green, colors[i].blue };
+            qt_gtk_add_data(hash, rgb, sizeof(rgb));
+        }
+    }
+    const quint16 bw[6] = { style->black.red, style->black.green, style->black.blue,
+                            style->white.red, style->white.green, style->white.blue };
+    qt_gtk_add_data(hash, bw, sizeof(bw));
+    const qint32 thickness[2] = { style->xthickness, style->ythickness };
+    qt_gtk_add_data(hash, thickness, sizeof(thickness));
+    if (style->font_desc) {
+        char *font = pango_font_description_to_string(style->font_desc);
+        qt_gtk_add_string(hash, QByteArray(font));
+        g_free(font);
+    }
+}
+
+static QByteArray qt_gtk_theme_identity()
+{
+    const QString themeName = QGtkStylePrivate::getThemeName();
+    QStringList files;
+    for (gchar **file = gtk_rc_get_default_files(); file && *file; ++file)
+        files.append(QFile::decodeName(*file));
+    gchar *themeDir = gtk_rc_get_theme_dir();
+    files.append(QFile::decodeName(themeDir) + QLatin1Char('/') + themeName + QLatin1String("/gtk-2.0/gtkrc"));
+    g_free(themeDir);
+    files.append(QDir::homePath() + QLatin1String("/.themes/") + themeName + QLatin1String("/gtk-2.0/gtkrc"));
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    qt_gtk_add_string(hash, QByteArray("qt6gtk2 " QT6GTK2_VERSION " Qt " QT_VERSION_STR));
+    qt_gtk_add_string(hash, QByteArray::number(int(cacheFormatVersion)));
+    qt_gtk_add_string(hash, themeName.toUtf8());
+    // Arrows, combo boxes and tabs are mirrored for right to left applications
+    qt_gtk_add_string(hash, QByteArray::number(int(gtk_widget_get_default_direction())));
+    for (const QString &path : qAsConst(files)) {
+        const QFileInfo info(path);
+        qt_gtk_add_string(hash, QFile::encodeName(path));
+        qt_gtk_add_string(hash, QByteArray::number(info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1));
+    }
+    return hash.result();
+}
+
+static void qt_gtk_close_cache(QGtkDiskCacheData *d)
+{
+    if (d->map)
+        d->file.unmap(d->map);
+    d->file.close();
+    d->map = nullptr;
+    d->mapSize = 0;
+    d->entries = nullptr;
+    d->count = 0;
+    d->opened = false;
+}
+
+static void qt_gtk_open_cache(QGtkDiskCacheData *d)
+{
+    d->opened = true;
+    d->identity = qt_gtk_theme_identity();
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                        + QLatin1String("/qt6gtk2/");
+    d->file.setFileName(dir + QString::fromLatin1(d->identity.toHex()) + QLatin1String(".cache"));
+    if (!d->syncOnExit) {
+        qAddPostRoutine(QGtkDiskCache::sync);
+        d->syncOnExit = true;
+    }
+
+    if (!d->file.open(QIODevice::ReadOnly))
+        return;
+    const qint64 size = d->file.size();
+    uchar *map = size >= qint64(sizeof(QGtkDiskCacheHeader)) ? d->file.map(0, size) : nullptr;
+    if (!map) {
+        d->file.close();
+        return;
+    }
+    const QGtkDiskCacheHeader *header = reinterpret_cast<const QGtkDiskCacheHeader *>(map);
+    if (memcmp(header->magic, qt_gtk_cache_magic, sizeof(header->magic)) != 0
+            || header->version != cacheFormatVersion
+            || memcmp(header->identity, d->identity.constData(), digestSize) != 0
+            || header->count > quint64(size - sizeof(QGtkDiskCacheHeader)) / sizeof(QGtkDiskCacheEntry)) {
+        d->file.unmap(map);
+        d->file.close();
+        return;
+    }
+    d->map = map;
+    d->mapSize = size;
+    d->entries = reinterpret_cast<const QGtkDiskCacheEntry *>(map + sizeof(QGtkDiskCacheHeader));
+    d->count = header->count;
+}
+
+// Entries are checked when they are used, so that a damaged file cannot
+// make us read outside of the mapping
+static bool qt_gtk_is_valid(const QGtkDiskCacheData *d, const QGtkDiskCacheEntry &entry)
+{
+    const QImage::Format format = QImage::Format(entry.format);
+    if (format != QImage::Format_ARGB32_Premultiplied && format != QImage::Format_RGB32)
+        return false;
+    const quint64 bytes = quint64(entry.width) * entry.height * 4;
+    return bytes && entry.offset % 4 == 0 && entry.offset <= quint64(d->mapSize)
+           && bytes <= quint64(d->mapSize) - entry.offset;
+}
+
+static const QGtkDiskCacheEntry *qt_gtk_find_entry(const QGtkDiskCacheData *d, const QByteArray &digest)
+{
+    const QGtkDiskCacheEntry *end = d->entries + d->count;
+    const QGtkDiskCacheEntry *entry = std::lower_bound(d->entries, end, digest,
+        [](const QGtkDiskCacheEntry &e, const QByteArray &value) {
+            return memcmp(e.digest, value.constData(), digestSize) < 0;
+        });
+    if (entry == end || memcmp(entry->digest, digest.constData(), digestSize) != 0)
+        return nullptr;
+    return qt_gtk_is_valid(d, *entry) ? entry : nullptr;
+}
+
+static void qt_gtk_sync_cache(QGtkDiskCacheData *d)
+{
+    if (d->pending.isEmpty())
+        return;
+
+    struct Item {
+        const uchar *digest;
+        const uchar *bits;
+        int width;
+        int height;
+        qsizetype bytesPerLine;
+        quint32 format;
+    };
+
+    QList<Item> items;
+    qint64 size = sizeof(QGtkDiskCacheHeader);
+    for (quint32 i = 0; i < d->count; ++i) {
+        const QGtkDiskCacheEntry &entry = d->entries[i];
+        if (!qt_gtk_is_valid(d, entry))
+            continue;
+        items.append({ entry.digest, d->map + entry.offset, entry.width, entry.height,
+                       qsizetype(entry.width) * 4, entry.format });
+        size += sizeof(QGtkDiskCacheEntry) + qint64(entry.width) * entry.height * 4;
+    }
+    for (QHash<QByteArray, QImage>::const_iterator it = d->pending.cbegin(); it != d->pending.cend(); ++it) {
+        const QImage &image = it.value();
+        const qint64 bytes = sizeof(QGtkDiskCacheEntry) + qint64(image.width()) * image.height() * 4;
+        if (size + bytes > maxFileSize)
+            break;
+        items.append({ reinterpret_cast<const uchar *>(it.key().constData()), image.constBits(),
+                       image.width(), image.height(), image.bytesPerLine(), quint32(image.format()) });
+        size += bytes;
+    }
+    std::sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+        return memcmp(a.digest, b.digest, digestSize) < 0;
+    });
+
+    const QString fileName = d->file.fileName();
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    // Written to a new file and renamed over the old one, processes that
+    // still map the old file are not affected
+    QSaveFile out(fileName);
+    if (out.open(QIODevice::WriteOnly)) {
+        QGtkDiskCacheHeader header;
+        memcpy(header.magic, qt_gtk_cache_magic, sizeof(header.magic));
+        header.version = cacheFormatVersion;
+        header.count = quint32(items.size());
+        memcpy(header.identity, d->identity.constData(), digestSize);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        quint64 offset = sizeof(QGtkDiskCacheHeader) + quint64(items.size()) * sizeof(QGtkDiskCacheEntry);
+        for (const Item &item : qAsConst(items)) {
+            QGtkDiskCacheEntry entry;
+            memcpy(entry.digest, item.digest, digestSize);
+            entry.offset = offset;
+            entry.width = quint16(item.width);
+            entry.height = quint16(item.height);
+            entry.format = item.format;
+            out.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+            offset += quint64(item.width) * item.height * 4;
+        }
+        for (const Item &item : qAsConst(items)) {
+            for (int y = 0; y < item.height; ++y)
+                out.write(reinterpret_cast<const char *>(item.bits + y * item.bytesPerLine), item.width * 4);
+        }
+        // Files of themes, gtkrc files or versions used before are not
+        // looked up again. Processes that map one keep their mapping.
+        if (out.commit()) {
+            const QDir dir = QFileInfo(fileName).absoluteDir();
+            const QString current = QFileInfo(fileName).fileName();
+            for (const QString &name : dir.entryList({ QStringLiteral("*.cache") }, QDir::Files)) {
+                if (name != current)
+                    QFile::remove(dir.filePath(name));
+            }
+        }
+    }
+
+    d->pending.clear();
+    d->pendingBytes = 0;
+    // picks up the new file on the next lookup
+    qt_gtk_close_cache(d);
+}
+
+bool QGtkDiskCache::isEnabled()
+{
+    return qt_gtk_disk_cache()->enabled;
+}
+
+QByteArray QGtkDiskCache::digest(const QGtkPixmapKey &key, GtkStyle *style)
+{
+    if (!key.element)
+        return QByteArray();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    // Pointers and interned ids are replaced by what they stand for
+    const qint32 fields[] = { key.element, key.state, key.shadow, key.flags, key.width, key.height,
+                              key.params[0], key.params[1], key.params[2], qint32(key.extra) };
+    qt_gtk_add_data(hash, fields, sizeof(fields));
+    qt_gtk_add_string(hash, key.detail ? QByteArray(reinterpret_cast<const char *>(quintptr(key.detail)))
+                                       : QByteArray());
+    qt_gtk_add_string(hash, QGtkPixmapCache::internedString(key.widget).toUtf8());
+    qt_gtk_add_style(hash, style);
+    return hash.result();
+}
+
+QByteArray QGtkDiskCache::themeIdentity()
+{
+    return qt_gtk_theme_identity();
+}
+
+bool QGtkDiskCache::find(const QByteArray &digest, QPixmap *pixmap)
+{
+    if (digest.size() != digestSize || !isEnabled())
+        return false;
+    QGtkDiskCacheData *d = qt_gtk_disk_cache();
+    if (!d->opened)
+        qt_gtk_open_cache(d);
+
+    QHash<QByteArray, QImage>::const_iterator it = d->pending.constFind(digest);
+    if (it != d->pending.constEnd()) {
+        *pixmap = QPixmap::fromImage(it.value());
+        return !pixmap->isNull();
+    }
+
+    const QGtkDiskCacheEntry *entry = qt_gtk_find_entry(d, digest);
+    if (!entry)
+        return false;
+    const QImage image(d->map + entry->offset, entry->width, entry->height, entry->width * 4,
+                       QImage::Format(entry->format));
+    // copy, the mapping goes away when the file is replaced
+    *pixmap = QPixmap::fromImage(image.copy());
+    return !pixmap->isNull();
+}
+
+void QGtkDiskCache::insert(const QByteArray &digest, const QImage &image)
+{
+    if (digest.size() != digestSize || image.isNull() || !isEnabled()
+            || image.width() > 0xffff || image.height() > 0xffff)
+        return;
+    QGtkDiskCacheData *d = qt_gtk_disk_cache();
+    const qint64 bytes = qint64(image.width()) * image.height() * 4;
+    if (d->pendingBytes + bytes > maxPendingBytes || d->pending.contains(digest))
+        return;
+    if (!d->opened)
+        qt_gtk_open_cache(d);
+    if (qt_gtk_find_entry(d, digest))
+        return;
+    d->pending.insert(digest, image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                          : QImage::Format_RGB32));
+    d->pendingBytes += bytes;
+}
+
+// Entries rendered so far belong to the file of the old theme
+void QGtkDiskCache::themeChanged()
+{
+    if (!qt_gtk_disk_cache.exists())
+        return;
+    QGtkDiskCacheData *d = qt_gtk_disk_cache();
+    qt_gtk_sync_cache(d);
+    qt_gtk_close_cache(d);
+}
+
+void QGtkDiskCache::sync()
+{
+    if (!qt_gtk_disk_cache.exists())
+        return;
+    QGtkDiskCacheData *d = qt_gtk_disk_cache();
+    // The gtkrc files changed without a theme change, new entries might
+    // not match what another process renders for them
+    if (d->opened && qt_gtk_theme_identity() != d->identity) {
+        d->pending.clear();
+        d->pendingBytes = 0;
+        return;
+    }
+    qt_gtk_sync_cache(d);
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
@@ -0,0 +1,73 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKDISKCACHE_P_H
+#define QGTKDISKCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QByteArray>
+#include <QImage>
+#include <QPixmap>
+#include "qgtkglobal_p.h"
+#include "qgtkpixmapcache_p.h"
+
+QT_BEGIN_NAMESPACE
+
+// Keeps rendered theme elements in a file below $XDG_CACHE_HOME/qt6gtk2,
+// so that later processes can paint them without calling the theme engine.
+// There is one file per theme, identified by the theme name, the mtimes of
+// the gtkrc files and the plugin version. Files are mapped read-only and
+// replaced atomically, new entries are written when the theme changes and
+// on exit. Only to be used from the GUI thread.
+class QGtkDiskCache
+{
+public:
+    static bool isEnabled();
+
+    // Returns an id of the element that is stable across processes
+    static QByteArray digest(const QGtkPixmapKey &key, GtkStyle *style);
+    // Identifies the current theme and its gtkrc files
+    static QByteArray themeIdentity();
+
+    static bool find(const QByteArray &digest, QPixmap *pixmap);
+    static void insert(const QByteArray &digest, const QImage &image);
+
+    static void themeChanged();
+    static void sync();
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKDISKCACHE_P_H
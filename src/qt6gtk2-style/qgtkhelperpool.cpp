@@ -0,0 +1,306 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtkhelperpool_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include "qgtkhelperprotocol_p.h"
+#include "qgtkstyle_p_p.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    maxHelpers   = 16,
+    helperMemory = 8 * 1024 * 1024, // result memory per helper
+    startTimeout = 1000,            // ms for all helpers to come up
+    batchTimeout = 200              // ms for all replies of a batch
+};
+
+static QGtkHelperPool *qt_gtk_helper_pool = nullptr;
+static bool qt_gtk_helper_pool_failed = false;
+
+// The GUI thread waits here, so a helper gets no more than the time left
+// until the deadline
+static bool qt_gtk_read_reply(QProcess *process, QGtkHelperReply *reply, const QDeadlineTimer &deadline)
+{
+    while (process->bytesAvailable() < qint64(sizeof(QGtkHelperReply))) {
+        if (deadline.hasExpired() || !process->waitForReadyRead(int(deadline.remainingTime())))
+            return false;
+    }
+    return process->read(reinterpret_cast<char *>(reply), sizeof(QGtkHelperReply)) == qint64(sizeof(QGtkHelperReply))
+           && reply->magic == QGtkHelperMagic && reply->version == QGtkHelperVersion;
+}
+
+static QGtkHelperElement qt_gtk_helper_element(quint8 element)
+{
+    switch (element) {
+    case QGtkPixmapKey::Box:
+        return QGtkHelperBox;
+    case QGtkPixmapKey::BoxGap:
+        return QGtkHelperBoxGap;
+    case QGtkPixmapKey::Slider:
+        return QGtkHelperSlider;
+    case QGtkPixmapKey::Extension:
+        return QGtkHelperExtension;
+    default:
+        return QGtkHelperElement(0);
+    }
+}
+
+QGtkHelperPool *QGtkHelperPool::instance()
+{
+    if (qt_gtk_helper_pool || qt_gtk_helper_pool_failed)
+        return qt_gtk_helper_pool;
+
+    const int count = qMin(qEnvironmentVariableIntValue("QT6GTK2_HELPERS"), int(maxHelpers));
+    if (count <= 0 || !QCoreApplication::instance()) {
+        qt_gtk_helper_pool_failed = true;
+        return nullptr;
+    }
+
+    // The helpers start in parallel and share one deadline
+    QGtkHelperPool *pool = new QGtkHelperPool;
+    QList<Helper *> started;
+    for (int i = 0; i < count; ++i) {
+        Helper *helper = new Helper;
+        pool->startHelper(helper, i);
+        started.append(helper);
+    }
+    const QDeadlineTimer deadline(startTimeout);
+    for (Helper *helper : qAsConst(started)) {
+        if (pool->waitForHelper(helper, deadline)) {
+            pool->m_helpers.append(helper);
+        } else {
+            pool->stopHelper(helper);
+            delete helper;
+        }
+    }
+    if (pool->m_helpers.isEmpty()) {
+        qWarning("QGtkStyle: qt6gtk2-helper is not available, rendering in-process");
+        delete pool;
+        qt_gtk_helper_pool_failed = true;
+        return nullptr;
+    }
+    qt_gtk_helper_pool = pool;
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        qAddPostRoutine(cleanup);
+    }
+    return pool;
+}
+
+void QGtkHelperPool::themeChanged()
+{
+    cleanup();
+    qt_gtk_helper_pool_failed = false;
+}
+
+void QGtkHelperPool::cleanup()
+{
+    delete qt_gtk_helper_pool;
+    qt_gtk_helper_pool = nullptr;
+}
+
+QGtkHelperPool::QGtkHelperPool() : m_next(0), m_nextId(1)
+{
+}
+
+QGtkHelperPool::~QGtkHelperPool()
+{
+    for (Helper *helper : qAsConst(m_helpers)) {
+        stopHelper(helper);
+        delete helper;
+    }
+}
+
+void QGtkHelperPool::startHelper(Helper *helper, int index)
+{
+    const QByteArray name = "/qt6gtk2-helper-" + QByteArray::number(qint64(getpid())) + '-'
+                            + QByteArray::number(index);
+    const int fd = shm_open(name.constData(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        return;
+    void *mapped = MAP_FAILED;
+    if (ftruncate(fd, helperMemory) == 0)
+        mapped = mmap(nullptr, helperMemory, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        shm_unlink(name.constData());
+        return;
+    }
+    helper->memory = static_cast<uchar *>(mapped);
+    helper->memoryName = name;
+
+    // The helper draws on the display of this process
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("DISPLAY"),
+                       QString::fromLocal8Bit(gdk_display_get_name(gdk_display_get_default())));
+    helper->process = new QProcess;
+    helper->process->setProcessEnvironment(environment);
+    helper->process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    helper->process->start(QStringLiteral(QT6GTK2_HELPER_PATH),
+                           { QString::fromLatin1(name), QString::number(helperMemory) });
+}
+
+bool QGtkHelperPool::waitForHelper(Helper *helper, const QDeadlineTimer &deadline)
+{
+    if (!helper->process)
+        return false;
+    QGtkHelperReply reply;
+    const bool ready = !deadline.hasExpired()
+                       && helper->process->waitForStarted(int(deadline.remainingTime()))
+                       && qt_gtk_read_reply(helper->process, &reply, deadline) && reply.id == 0 && reply.status == 0;
+    // the helper has mapped the memory once it is ready
+    shm_unlink(helper->memoryName.constData());
+    helper->memoryName.clear();
+    return ready;
+}
+
+void QGtkHelperPool::stopHelper(Helper *helper)
+{
+    if (helper->process) {
+        helper->process->closeWriteChannel();
+        if (!helper->process->waitForFinished(100))
+            helper->process->kill();
+        helper->process->waitForFinished(100);
+        delete helper->process;
+        helper->process = nullptr;
+    }
+    if (helper->memory) {
+        munmap(helper->memory, helperMemory);
+        helper->memory = nullptr;
+    }
+    helper->jobs.clear();
+    helper->used = 0;
+}
+
+bool QGtkHelperPool::submit(const QGtkPixmapKey &key, const QByteArray &digest, GtkWidget *gtkWidget,
+                            GtkStyle *style)
+{
+    // The helper draws with fresh left-to-right widgets in their resting
+    // state, so anything the key carries beyond that (the default button
+    // bit in extra), the widget's direction and the inverted flag and
+    // adjustment the style sets on ranges and progress bars stay in process
+    const QGtkHelperElement element = qt_gtk_helper_element(key.element);
+    if (!element || key.extra != 0 || !gtkWidget || gtk_widget_get_style(gtkWidget) != style
+            || GTK_IS_RANGE(gtkWidget) || GTK_IS_PROGRESS_BAR(gtkWidget)
+            || GTK_WIDGET_HAS_FOCUS(gtkWidget) || GTK_WIDGET_HAS_DEFAULT(gtkWidget)
+            || gtk_widget_get_default_direction() != GTK_TEXT_DIR_LTR
+            || gtk_widget_get_direction(gtkWidget) != GTK_TEXT_DIR_LTR
+            || GTK_WIDGET_STATE(gtkWidget) != GTK_STATE_NORMAL
+            || (GTK_IS_TOGGLE_BUTTON(gtkWidget) && gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(gtkWidget))))
+        return false;
+    if (key.widget != QGtkStylePrivate::widgetClassId(gtkWidget))
+        return false;
+    const QByteArray widget = QGtkPixmapCache::internedString(key.widget).toLatin1();
+    const char *detail = reinterpret_cast<const char *>(quintptr(key.detail));
+    QGtkHelperRequest request;
+    memset(&request, 0, sizeof(request));
+    if (widget.isEmpty() || widget.contains('.') || widget.size() >= int(sizeof(request.widget))
+            || (detail && strlen(detail) >= sizeof(request.detail)))
+        return false;
+
+    const quint32 bytes = quint32(key.width) * quint32(key.height) * 4;
+    for (qsizetype i = 0; i < m_helpers.size(); ++i) {
+        Helper *helper = m_helpers.at((m_next + i) % m_helpers.size());
+        if (helper->used + bytes > quint32(helperMemory))
+            continue;
+
+        request.magic = QGtkHelperMagic;
+        request.id = m_nextId++;
+        request.offset = helper->used;
+        request.width = key.width;
+        request.height = key.height;
+        memcpy(request.params, key.params, sizeof(request.params));
+        request.element = quint8(element);
+        request.state = key.state;
+        request.shadow = key.shadow;
+        request.flags = (key.flags & QGtkPixmapKey::Alpha) ? quint8(QGtkHelperAlpha) : quint8(0);
+        if (detail)
+            strcpy(request.detail, detail);
+        memcpy(request.widget, widget.constData(), size_t(widget.size()));
+        if (helper->process->write(reinterpret_cast<const char *>(&request), sizeof(request))
+                != qint64(sizeof(request)))
+            return false;
+
+        helper->jobs.append({ key, digest, request.id, request.offset });
+        helper->used += (bytes + 15) & ~15u;
+        m_next = (m_next + i + 1) % m_helpers.size();
+        return true;
+    }
+    return false;
+}
+
+void QGtkHelperPool::collect(const InsertFunc &insert)
+{
+    const QDeadlineTimer deadline(batchTimeout);
+    for (qsizetype i = 0; i < m_helpers.size(); ++i) {
+        Helper *helper = m_helpers.at(i);
+        bool alive = true;
+        for (const Job &job : qAsConst(helper->jobs)) {
+            QGtkHelperReply reply;
+            if (!qt_gtk_read_reply(helper->process, &reply, deadline) || reply.id != job.id) {
+                alive = false;
+                break;
+            }
+            if (reply.status != 0)
+                continue;
+
+            const QGtkPixmapKey &key = job.key;
+            const bool alpha = key.flags & QGtkPixmapKey::Alpha;
+            QImage image(key.width, key.height, alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+            if (image.isNull())
+                continue;
+            const uchar *pixels = helper->memory + job.offset;
+            for (int y = 0; y < key.height; ++y)
+                memcpy(image.scanLine(y), pixels + y * key.width * 4, size_t(key.width) * 4);
+            const bool hflipped = key.flags & QGtkPixmapKey::FlipHorizontal;
+            const bool vflipped = key.flags & QGtkPixmapKey::FlipVertical;
+            if (hflipped || vflipped)
+                image = image.mirrored(hflipped, vflipped);
+            insert(key, job.digest, image);
+        }
+        helper->jobs.clear();
+        helper->used = 0;
+
+        if (!alive) {
+            qWarning("QGtkStyle: qt6gtk2-helper is too slow or stopped responding, rendering in-process");
+            stopHelper(helper);
+            delete helper;
+            m_helpers.removeAt(i--);
+        }
+    }
+    m_next = 0;
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
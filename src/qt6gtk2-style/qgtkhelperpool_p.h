@@ -0,0 +1,114 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKHELPERPOOL_P_H
+#define QGTKHELPERPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <functional>
+#include <QByteArray>
+#include <QImage>
+#include <QList>
+#include "qgtkglobal_p.h"
+#include "qgtkpixmapcache_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QDeadlineTimer;
+class QProcess;
+
+// Renders batched cache misses in qt6gtk2-helper processes. The helpers
+// run the same gtk engine on the same display, so misses are rendered in
+// parallel, and an engine crash only costs the jobs queued to the helper
+// that crashed. Those are then rendered in-process the next time they are
+// painted. Replies are only waited for until a short deadline per batch,
+// a helper that misses it is dropped the same way.
+//
+// Only elements that the helper can rebuild from the key are sent: boxes,
+// box gaps, sliders and extensions of proxy widgets that are direct
+// children of the proxy window, drawn with the widget's own style while
+// the widget is in its resting state. Ranges and progress bars are left
+// out, the style configures them before it paints.
+class QGtkHelperPool
+{
+public:
+    typedef std::function<void (const QGtkPixmapKey &key, const QByteArray &digest,
+                                const QImage &image)> InsertFunc;
+
+    // Returns null unless QT6GTK2_HELPERS asks for helpers and at least
+    // one of them is running
+    static QGtkHelperPool *instance();
+    // Stops the helpers, they are started again with the new theme
+    static void themeChanged();
+
+    bool submit(const QGtkPixmapKey &key, const QByteArray &digest, GtkWidget *gtkWidget, GtkStyle *style);
+    // Waits a bounded time for the submitted jobs and hands the results
+    // to insert
+    void collect(const InsertFunc &insert);
+
+private:
+    struct Job
+    {
+        QGtkPixmapKey key;
+        QByteArray digest;
+        quint32 id;
+        quint32 offset;
+    };
+
+    struct Helper
+    {
+        QProcess *process = nullptr;
+        uchar *memory = nullptr;
+        QByteArray memoryName;
+        quint32 used = 0;
+        QList<Job> jobs;
+    };
+
+    QGtkHelperPool();
+    ~QGtkHelperPool();
+
+    static void cleanup();
+    void startHelper(Helper *helper, int index);
+    bool waitForHelper(Helper *helper, const QDeadlineTimer &deadline);
+    void stopHelper(Helper *helper);
+
+    QList<Helper *> m_helpers;
+    qsizetype m_next;
+    quint32 m_nextId;
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKHELPERPOOL_P_H
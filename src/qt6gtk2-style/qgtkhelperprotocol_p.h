@@ -0,0 +1,90 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKHELPERPROTOCOL_P_H
+#define QGTKHELPERPROTOCOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+
+// Messages between the style and qt6gtk2-helper. Requests are written to
+// the standard input of the helper and answered in order on its standard
+// output. Pixels are returned in a shared memory segment that the style
+// creates for every helper and passes on the command line.
+
+enum {
+    QGtkHelperMagic   = 0x51474831, // "QGH1"
+    QGtkHelperVersion = 1
+};
+
+enum QGtkHelperElement
+{
+    QGtkHelperBox = 1,
+    QGtkHelperBoxGap,
+    QGtkHelperSlider,
+    QGtkHelperExtension
+};
+
+enum QGtkHelperFlag
+{
+    QGtkHelperAlpha = 0x1 // recover the alpha channel, otherwise drawn on the background color
+};
+
+struct QGtkHelperRequest
+{
+    quint32 magic;
+    quint32 id;
+    quint32 offset;     // of the result in the shared memory
+    qint32 width;
+    qint32 height;
+    qint32 params[3];   // as in QGtkPixmapKey
+    quint8 element;     // QGtkHelperElement
+    quint8 state;
+    quint8 shadow;
+    quint8 flags;       // QGtkHelperFlag
+    char detail[32];
+    char widget[64];    // gtk type name of a direct child of the proxy window
+};
+
+// The helper sends a reply with id 0 once it is ready. Results are
+// premultiplied ARGB32 pixels with width * 4 bytes per line.
+struct QGtkHelperReply
+{
+    quint32 magic;
+    quint32 id;
+    qint32 status;      // 0 on success
+    quint32 version;
+};
+
+QT_END_NAMESPACE
+
+#endif // QGTKHELPERPROTOCOL_P_H
@@ -19,11 +19,10 @@
  ***************************************************************************/
 
 #include "qgtkpainter_p.h"
+#include "qgtkstyle_p_p.h"
 
 #if !defined(QT_NO_STYLE_GTK)
 
-#include <private/qhexstring_p.h>
-
 QT_BEGIN_NAMESPACE
 
 QGtkPainter::QGtkPainter()
@@ -42,20 +41,36 @@ void QGtkPainter::reset(QPainter *painter)
     m_hflipped = false;
     m_vflipped = false;
     m_usePixmapCache = true;
+    m_ninePatch = Qt::Orientations();
     m_cliprect = QRect();
 }
 
-QString QGtkPainter::uniqueName(const QString &key, GtkStateType state, GtkShadowType shadow,
-                                const QSize &size, GtkWidget *widget)
+// Note detail has to be a string literal, it is keyed by its address.
+// extra is a value packed by the caller, it distinguishes renders that
+// differ in something the other fields do not cover.
+// Widgets are keyed by their class path and the style they are drawn
+// with, so identical renders are shared between widget instances.
+QGtkPixmapKey QGtkPainter::pixmapKey(QGtkPixmapKey::Element element, const gchar *detail, GtkStateType state,
+                                     GtkShadowType shadow, const QSize &size, GtkStyle *style, GtkWidget *widget,
+                                     quint32 extra, int param0, int param1, int param2) const
 {
-    // Note the widget arg should ideally use the widget path, though would compromise performance
-    QString tmp = key
-                  % HexString<uint>(state)
-                  % HexString<uint>(shadow)
-                  % HexString<uint>(size.width())
-                  % HexString<uint>(size.height())
-                  % HexString<quint64>(quint64(widget));
-    return tmp;
+    QGtkPixmapKey key;
+    key.detail = quint64(quintptr(detail));
+    key.style = quint64(quintptr(style));
+    key.width = size.width();
+    key.height = size.height();
+    key.params[0] = param0;
+    key.params[1] = param1;
+    key.params[2] = param2;
+    key.widget = QGtkStylePrivate::widgetClassId(widget);
+    key.extra = extra;
+    key.element = quint8(element);
+    key.state = quint8(state);
+    key.shadow = quint8(shadow);
+    key.flags = quint8((m_alpha ? QGtkPixmapKey::Alpha : 0)
+                       | (m_hflipped ? QGtkPixmapKey::FlipHorizontal : 0)
+                       | (m_vflipped ? QGtkPixmapKey::FlipVertical : 0));
+    return key;
 }
 
 QT_END_NAMESPACE
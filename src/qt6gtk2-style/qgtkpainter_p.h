@@ -36,6 +36,7 @@
 #if !defined(QT_NO_STYLE_GTK)
 
 #include "qgtkglobal_p.h"
+#include "qgtkpixmapcache_p.h"
 #include <QSize>
 #include <QRect>
 #include <QPoint>
@@ -57,45 +58,60 @@ public:
     void setFlipHorizontal(bool value) { m_hflipped = value; }
     void setFlipVertical(bool value) { m_vflipped = value; }
     void setUsePixmapCache(bool value) { m_usePixmapCache = value; }
+    // Boxes may be rendered at a canonical size along these axes and
+    // stretched from there as a nine-patch
+    void setNinePatchStretch(Qt::Orientations orientations) { m_ninePatch = orientations; }
+
+    // Called when the gtk theme or its settings have changed
+    virtual void themeChanged() {}
+
+    // Between these calls cache misses only fill the pixmap cache, they are
+    // rendered together when the outermost batch ends. Nothing is painted
+    // for them, so batches are meant for offscreen passes.
+    virtual void beginBatch() {}
+    virtual void endBatch() {}
 
     virtual void paintBoxGap(GtkWidget *gtkWidget, const gchar* part, const QRect &rect,
                              GtkStateType state, GtkShadowType shadow, GtkPositionType gap_side, gint x,
                              gint width, GtkStyle *style) = 0;
     virtual void paintBox(GtkWidget *gtkWidget, const gchar* part,
                           const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style,
-                          const QString &pmKey = QString()) = 0;
+                          quint32 pmKey = 0) = 0;
     virtual void paintHline(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkStyle *style,
-                            int x1, int x2, int y, const QString &pmKey = QString()) = 0;
+                            int x1, int x2, int y, quint32 pmKey = 0) = 0;
     virtual void paintVline(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkStyle *style,
-                            int y1, int y2, int x, const QString &pmKey = QString()) = 0;
+                            int y1, int y2, int x, quint32 pmKey = 0) = 0;
     virtual void paintExpander(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state,
-                               GtkExpanderStyle expander_state, GtkStyle *style, const QString &pmKey = QString()) = 0;
+                               GtkExpanderStyle expander_state, GtkStyle *style, quint32 pmKey = 0) = 0;
     virtual void paintFocus(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkStyle *style,
-                            const QString &pmKey = QString()) = 0;
+                            quint32 pmKey = 0) = 0;
     virtual void paintResizeGrip(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow,
-                                 GdkWindowEdge edge, GtkStyle *style, const QString &pmKey = QString()) = 0;
+                                 GdkWindowEdge edge, GtkStyle *style, quint32 pmKey = 0) = 0;
     virtual void paintArrow(GtkWidget *gtkWidget, const gchar* part, const QRect &arrowrect, GtkArrowType arrow_type, GtkStateType state, GtkShadowType shadow,
-                            gboolean fill, GtkStyle *style, const QString &pmKey = QString()) = 0;
+                            gboolean fill, GtkStyle *style, quint32 pmKey = 0) = 0;
     virtual void paintHandle(GtkWidget *gtkWidget, const gchar* part, const QRect &rect,
                              GtkStateType state, GtkShadowType shadow, GtkOrientation orientation, GtkStyle *style) = 0;
     virtual void paintSlider(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow,
-                             GtkStyle *style, GtkOrientation orientation, const QString &pmKey = QString()) = 0;
+                             GtkStyle *style, GtkOrientation orientation, quint32 pmKey = 0) = 0;
     virtual void paintShadow(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow,
-                             GtkStyle *style, const QString &pmKey = QString()) = 0;
-    virtual void paintFlatBox(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const QString & = QString()) = 0;
+                             GtkStyle *style, quint32 pmKey = 0) = 0;
+    virtual void paintFlatBox(GtkWidget *gtkWidget, const gchar* part, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, quint32 pmKey = 0) = 0;
     virtual void paintExtention(GtkWidget *gtkWidget, const gchar *part, const QRect &rect, GtkStateType state, GtkShadowType shadow,
                                 GtkPositionType gap_pos, GtkStyle *style) = 0;
-    virtual void paintOption(GtkWidget *gtkWidget, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const QString &detail) = 0;
-    virtual void paintCheckbox(GtkWidget *gtkWidget, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const QString &detail) = 0;
+    virtual void paintOption(GtkWidget *gtkWidget, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const gchar *detail) = 0;
+    virtual void paintCheckbox(GtkWidget *gtkWidget, const QRect &rect, GtkStateType state, GtkShadowType shadow, GtkStyle *style, const gchar *detail) = 0;
 
 protected:
-    static QString uniqueName(const QString &key, GtkStateType state, GtkShadowType shadow, const QSize &size, GtkWidget *widget = nullptr);
+    QGtkPixmapKey pixmapKey(QGtkPixmapKey::Element element, const gchar *detail, GtkStateType state, GtkShadowType shadow,
+                            const QSize &size, GtkStyle *style, GtkWidget *widget = nullptr,
+                            quint32 extra = 0, int param0 = 0, int param1 = 0, int param2 = 0) const;
 
     QPainter *m_painter;
     bool m_alpha;
     bool m_hflipped;
     bool m_vflipped;
     bool m_usePixmapCache;
+    Qt::Orientations m_ninePatch;
     QRect m_cliprect;
 };
 
@@ -0,0 +1,143 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtkpixmapcache_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QCache>
+#include <QHash>
+#include <QList>
+#include <QPixmapCache>
+#include "qgtkstats_p.h"
+
+QT_BEGIN_NAMESPACE
+
+struct QGtkPixmapCacheEntry
+{
+    QPixmap pixmap;
+    quint32 generation;
+};
+
+// Budget in bytes, QT6GTK2_CACHE_SIZE is given in kilobytes. The default
+// is the one of QPixmapCache.
+static qsizetype qt_gtk_cache_budget()
+{
+    bool ok = false;
+    const int size = qEnvironmentVariableIntValue("QT6GTK2_CACHE_SIZE", &ok);
+    return qsizetype(ok && size > 0 ? size : QPixmapCache::cacheLimit()) * 1024;
+}
+
+class QGtkPixmapCacheData
+{
+public:
+    QGtkPixmapCacheData() : cache(qt_gtk_cache_budget()), generation(0) {}
+
+    QCache<QGtkPixmapKey, QGtkPixmapCacheEntry> cache;
+    quint32 generation;
+};
+
+Q_GLOBAL_STATIC(QGtkPixmapCacheData, qt_gtk_pixmap_cache)
+struct QGtkInternedStrings
+{
+    QHash<QString, quint32> ids;
+    QList<QString> strings;
+};
+
+Q_GLOBAL_STATIC(QGtkInternedStrings, qt_gtk_interned_strings)
+
+static inline qsizetype qt_gtk_pixmap_cost(const QPixmap &pixmap)
+{
+    return qMax<qsizetype>(1, qsizetype(pixmap.width()) * pixmap.height() * pixmap.depth() / 8);
+}
+
+bool QGtkPixmapCache::find(const QGtkPixmapKey &key, QPixmap *pixmap)
+{
+    QGtkPixmapCacheData *d = qt_gtk_pixmap_cache();
+    const QGtkPixmapCacheEntry *entry = d->cache.object(key);
+    if (entry && entry->generation != d->generation) {
+        // rendered for an earlier theme
+        d->cache.remove(key);
+        entry = nullptr;
+    }
+    if (QGtkStats::isEnabled() && pixmap) {
+        if (entry)
+            QGtkStats::hit(key);
+        else
+            QGtkStats::miss(key);
+    }
+    if (!entry)
+        return false;
+    if (pixmap)
+        *pixmap = entry->pixmap;
+    return true;
+}
+
+void QGtkPixmapCache::insert(const QGtkPixmapKey &key, const QPixmap &pixmap)
+{
+    if (pixmap.isNull())
+        return;
+    QGtkPixmapCacheData *d = qt_gtk_pixmap_cache();
+    const qsizetype cost = qt_gtk_pixmap_cost(pixmap);
+    if (QGtkStats::isEnabled()) {
+        const qsizetype count = d->cache.count() + (d->cache.contains(key) ? 0 : 1);
+        d->cache.insert(key, new QGtkPixmapCacheEntry{pixmap, d->generation}, cost);
+        QGtkStats::cached(cost, qMax<qsizetype>(0, count - d->cache.count()));
+        return;
+    }
+    d->cache.insert(key, new QGtkPixmapCacheEntry{pixmap, d->generation}, cost);
+}
+
+void QGtkPixmapCache::invalidate()
+{
+    if (qt_gtk_pixmap_cache.exists())
+        ++qt_gtk_pixmap_cache()->generation;
+}
+
+void QGtkPixmapCache::clear()
+{
+    if (qt_gtk_pixmap_cache.exists())
+        qt_gtk_pixmap_cache()->cache.clear();
+}
+
+quint32 QGtkPixmapCache::intern(const QString &str)
+{
+    if (str.isEmpty())
+        return 0;
+    QGtkInternedStrings *interned = qt_gtk_interned_strings();
+    QHash<QString, quint32>::const_iterator it = interned->ids.constFind(str);
+    if (it == interned->ids.constEnd()) {
+        interned->strings.append(str);
+        it = interned->ids.insert(str, quint32(interned->strings.size()));
+    }
+    return it.value();
+}
+
+QString QGtkPixmapCache::internedString(quint32 id)
+{
+    if (!id || !qt_gtk_interned_strings.exists())
+        return QString();
+    return qt_gtk_interned_strings()->strings.value(qsizetype(id) - 1);
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKPIXMAPCACHE_P_H
+#define QGTKPIXMAPCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QHashFunctions>
+#include <QPixmap>
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+// Identifies a rendered theme element. This is plain data without padding,
+// so building, hashing and comparing it does not allocate.
+struct QGtkPixmapKey
+{
+    enum Element {
+        BoxGap = 1,
+        Box,
+        Hline,
+        Vline,
+        Expander,
+        Focus,
+        ResizeGrip,
+        Arrow,
+        Handle,
+        Slider,
+        Shadow,
+        FlatBox,
+        Extension,
+        Option,
+        Check,
+        WindowFrame,    // composed by QGtkStyle itself
+        ComboBox        // composed by QGtkStyle itself
+    };
+
+    enum Flag {
+        Alpha          = 0x1,
+        FlipHorizontal = 0x2,
+        FlipVertical   = 0x4
+    };
+
+    quint64 detail;     // address of the detail string literal
+    quint64 style;      // GtkStyle the element is drawn with
+    qint32 width;
+    qint32 height;
+    qint32 params[3];   // element specific arguments
+    quint32 widget;     // interned class path of the widget, 0 if there is none
+    quint32 extra;      // caller supplied discriminator, 0 if there is none
+    quint8 element;
+    quint8 state;
+    quint8 shadow;
+    quint8 flags;
+};
+
+Q_STATIC_ASSERT(sizeof(QGtkPixmapKey) == 48);
+Q_DECLARE_TYPEINFO(QGtkPixmapKey, Q_PRIMITIVE_TYPE);
+
+inline bool operator==(const QGtkPixmapKey &k1, const QGtkPixmapKey &k2) noexcept
+{
+    return memcmp(&k1, &k2, sizeof(QGtkPixmapKey)) == 0;
+}
+
+inline bool operator!=(const QGtkPixmapKey &k1, const QGtkPixmapKey &k2) noexcept
+{
+    return !operator==(k1, k2);
+}
+
+inline size_t qHash(const QGtkPixmapKey &key, size_t seed = 0) noexcept
+{
+    return qHashBits(&key, sizeof(QGtkPixmapKey), seed);
+}
+
+// Pixmap cache for rendered theme elements, kept apart from QPixmapCache
+// and indexed by QGtkPixmapKey. It has its own memory budget and drops
+// the least recently used entries first. Only to be used from the GUI
+// thread.
+class QGtkPixmapCache
+{
+public:
+    // pixmap may be null to only check for the key
+    static bool find(const QGtkPixmapKey &key, QPixmap *pixmap);
+    static void insert(const QGtkPixmapKey &key, const QPixmap &pixmap);
+
+    // Starts a new generation, entries of older ones are not found anymore
+    // and make room as they are evicted
+    static void invalidate();
+    static void clear();
+
+    // Maps strings to small ids for QGtkPixmapKey::widget
+    static quint32 intern(const QString &str);
+    static QString internedString(quint32 id);
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKPIXMAPCACHE_P_H
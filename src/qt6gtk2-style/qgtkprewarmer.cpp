@@ -0,0 +1,275 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtkprewarmer_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QApplication>
+#include <QCheckBox>
+#include <QElapsedTimer>
+#include <QLineEdit>
+#include <QMenu>
+#include <QPainter>
+#include <QPointer>
+#include <QPushButton>
+#include <QRadioButton>
+#include <QScrollBar>
+#include <QStyle>
+#include <QStyleOption>
+#include <QTimer>
+#include "qgtkpainter_p.h"
+#include "qgtkstyle_p_p.h"
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    sliceTime   = 4,    // ms spent rendering before yielding
+    maxExtent   = 1024  // larger controls are left alone
+};
+
+enum ControlKind {
+    PushButton = 1,
+    LineEdit,
+    ScrollBar,
+    CheckBox,
+    RadioButton,
+    MenuItem
+};
+
+static inline quint64 qt_gtk_prewarm_key(ControlKind kind, const QSize &size, uint variant = 0)
+{
+    return (quint64(kind) << 56) | (quint64(variant & 0xff) << 48)
+           | (quint64(size.width() & 0xffffff) << 24) | quint64(size.height() & 0xffffff);
+}
+
+QGtkPrewarmer::QGtkPrewarmer(QStyle *style)
+    : QObject(style), m_style(style), m_next(0), m_scheduled(false)
+{
+}
+
+void QGtkPrewarmer::start()
+{
+    if (m_scheduled)
+        return;
+    m_scheduled = true;
+    QTimer::singleShot(0, this, [this]() {
+        collect();
+        runSlice();
+    });
+}
+
+void QGtkPrewarmer::themeChanged()
+{
+    m_seen.clear();
+    start();
+}
+
+void QGtkPrewarmer::collect()
+{
+    QSize extent = m_scratch.size();
+    const QWidgetList widgets = QApplication::allWidgets();
+    for (QWidget *widget : widgets) {
+        if (widget->style() != m_style)
+            continue;
+        const QSize size = widget->size();
+        if (size.isEmpty() || size.width() > maxExtent || size.height() > maxExtent)
+            continue;
+
+        QPointer<QWidget> guard(widget);
+        QStyle *style = m_style;
+        Job job;
+        if (QPushButton *button = qobject_cast<QPushButton *>(widget)) {
+            if (m_seen.contains(qt_gtk_prewarm_key(PushButton, size, button->isDefault())))
+                continue;
+            m_seen.insert(qt_gtk_prewarm_key(PushButton, size, button->isDefault()));
+            job = [guard, style](QPainter *painter) {
+                QPushButton *button = qobject_cast<QPushButton *>(guard.data());
+                if (!button)
+                    return;
+                QStyleOptionButton option;
+                option.initFrom(button);
+                option.rect = QRect(QPoint(), button->size());
+                if (button->isDefault())
+                    option.features |= QStyleOptionButton::DefaultButton;
+                const QStyle::State base = option.state & ~(QStyle::State_MouseOver | QStyle::State_Sunken);
+                for (QStyle::State state : { QStyle::State_Raised, QStyle::State_Raised | QStyle::State_MouseOver,
+                                             QStyle::State_Sunken | QStyle::State_MouseOver }) {
+                    option.state = base | state;
+                    style->drawPrimitive(QStyle::PE_PanelButtonCommand, &option, painter, button);
+                }
+            };
+        } else if (QLineEdit *edit = qobject_cast<QLineEdit *>(widget)) {
+            if (!edit->hasFrame() || m_seen.contains(qt_gtk_prewarm_key(LineEdit, size)))
+                continue;
+            m_seen.insert(qt_gtk_prewarm_key(LineEdit, size));
+            job = [guard, style](QPainter *painter) {
+                QLineEdit *edit = qobject_cast<QLineEdit *>(guard.data());
+                if (!edit)
+                    return;
+                QStyleOptionFrame option;
+                option.initFrom(edit);
+                option.rect = QRect(QPoint(), edit->size());
+                option.lineWidth = style->pixelMetric(QStyle::PM_DefaultFrameWidth, &option, edit);
+                option.state |= QStyle::State_Sunken;
+                for (bool focus : { false, true }) {
+                    option.state.setFlag(QStyle::State_HasFocus, focus);
+                    style->drawPrimitive(QStyle::PE_PanelLineEdit, &option, painter, edit);
+                }
+            };
+        } else if (QScrollBar *scrollBar = qobject_cast<QScrollBar *>(widget)) {
+            if (m_seen.contains(qt_gtk_prewarm_key(ScrollBar, size, scrollBar->orientation())))
+                continue;
+            m_seen.insert(qt_gtk_prewarm_key(ScrollBar, size, scrollBar->orientation()));
+            job = [guard, style](QPainter *painter) {
+                QScrollBar *scrollBar = qobject_cast<QScrollBar *>(guard.data());
+                if (!scrollBar)
+                    return;
+                QStyleOptionSlider option;
+                option.initFrom(scrollBar);
+                option.rect = QRect(QPoint(), scrollBar->size());
+                option.subControls = QStyle::SC_All;
+                option.orientation = scrollBar->orientation();
+                option.minimum = scrollBar->minimum();
+                option.maximum = scrollBar->maximum();
+                option.sliderPosition = scrollBar->sliderPosition();
+                option.sliderValue = scrollBar->value();
+                option.singleStep = scrollBar->singleStep();
+                option.pageStep = scrollBar->pageStep();
+                option.upsideDown = scrollBar->invertedAppearance();
+                if (option.orientation == Qt::Horizontal)
+                    option.state |= QStyle::State_Horizontal;
+                const QStyle::State base = option.state & ~(QStyle::State_MouseOver | QStyle::State_Sunken);
+                for (QStyle::SubControl active : { QStyle::SC_None, QStyle::SC_ScrollBarSlider,
+                                                   QStyle::SC_ScrollBarAddLine, QStyle::SC_ScrollBarSubLine }) {
+                    option.activeSubControls = active;
+                    option.state = base | QStyle::State_MouseOver;
+                    style->drawComplexControl(QStyle::CC_ScrollBar, &option, painter, scrollBar);
+                    if (active != QStyle::SC_None) {
+                        option.state |= QStyle::State_Sunken;
+                        style->drawComplexControl(QStyle::CC_ScrollBar, &option, painter, scrollBar);
+                    }
+                }
+            };
+        } else if (qobject_cast<QCheckBox *>(widget) || qobject_cast<QRadioButton *>(widget)) {
+            const bool radio = qobject_cast<QRadioButton *>(widget);
+            QStyleOptionButton probe;
+            probe.initFrom(widget);
+            const QSize indicator = m_style->subElementRect(radio ? QStyle::SE_RadioButtonIndicator
+                                                                  : QStyle::SE_CheckBoxIndicator,
+                                                            &probe, widget).size();
+            const quint64 key = qt_gtk_prewarm_key(radio ? RadioButton : CheckBox, indicator);
+            if (indicator.isEmpty() || m_seen.contains(key))
+                continue;
+            m_seen.insert(key);
+            job = [guard, style, radio](QPainter *painter) {
+                QWidget *widget = guard.data();
+                if (!widget)
+                    return;
+                QStyleOptionButton option;
+                option.initFrom(widget);
+                option.rect = style->subElementRect(radio ? QStyle::SE_RadioButtonIndicator
+                                                          : QStyle::SE_CheckBoxIndicator, &option, widget);
+                option.rect.moveTopLeft(QPoint());
+                const QStyle::State base = option.state & ~(QStyle::State_MouseOver | QStyle::State_Sunken
+                                                            | QStyle::State_On | QStyle::State_Off);
+                for (QStyle::State check : { QStyle::State_Off, QStyle::State_On }) {
+                    for (QStyle::State state : { QStyle::State_None, QStyle::State_MouseOver,
+                                                 QStyle::State_Sunken | QStyle::State_MouseOver }) {
+                        option.state = base | check | state;
+                        style->drawPrimitive(radio ? QStyle::PE_IndicatorRadioButton : QStyle::PE_IndicatorCheckBox,
+                                             &option, painter, widget);
+                    }
+                }
+            };
+        } else if (QMenu *menu = qobject_cast<QMenu *>(widget)) {
+            // Menus are mostly hidden, the items are sized from the actions
+            QAction *action = nullptr;
+            const QList<QAction *> actions = menu->actions();
+            for (QAction *candidate : actions) {
+                if (!candidate->isSeparator() && candidate->isVisible()) {
+                    action = candidate;
+                    break;
+                }
+            }
+            const QSize itemSize = action ? menu->actionGeometry(action).size() : QSize();
+            if (itemSize.isEmpty() || itemSize.width() > maxExtent
+                    || m_seen.contains(qt_gtk_prewarm_key(MenuItem, itemSize)))
+                continue;
+            m_seen.insert(qt_gtk_prewarm_key(MenuItem, itemSize));
+            QPointer<QAction> actionGuard(action);
+            job = [guard, actionGuard, style](QPainter *painter) {
+                QMenu *menu = qobject_cast<QMenu *>(guard.data());
+                QAction *action = actionGuard.data();
+                if (!menu || !action)
+                    return;
+                QStyleOptionMenuItem option;
+                option.initFrom(menu);
+                option.rect = QRect(QPoint(), menu->actionGeometry(action).size());
+                option.menuRect = menu->rect();
+                option.menuItemType = QStyleOptionMenuItem::Normal;
+                option.checkType = QStyleOptionMenuItem::NotCheckable;
+                option.text = action->text();
+                option.state |= QStyle::State_Selected | QStyle::State_Enabled;
+                style->drawControl(QStyle::CE_MenuItem, &option, painter, menu);
+            };
+        }
+
+        if (job) {
+            m_jobs.append(job);
+            extent = extent.expandedTo(size);
+        }
+    }
+
+    if (extent != m_scratch.size())
+        m_scratch = QImage(extent, QImage::Format_ARGB32_Premultiplied);
+}
+
+void QGtkPrewarmer::runSlice()
+{
+    if (m_next >= m_jobs.size() || m_scratch.isNull()) {
+        m_jobs.clear();
+        m_next = 0;
+        m_scheduled = false;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    // Misses are only queued and read back together when the batch ends
+    QGtkStylePrivate::gtkPainter()->beginBatch();
+    {
+        QPainter painter(&m_scratch);
+        while (m_next < m_jobs.size() && timer.elapsed() < sliceTime) {
+            painter.save();
+            m_jobs.at(m_next++)(&painter);
+            painter.restore();
+        }
+    }
+    QGtkStylePrivate::gtkPainter()->endBatch();
+
+    // Yield to pending events before the next slice
+    QTimer::singleShot(0, this, [this]() { runSlice(); });
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
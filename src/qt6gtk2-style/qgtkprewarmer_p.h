@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKPREWARMER_P_H
+#define QGTKPREWARMER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <functional>
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include <QImage>
+
+QT_BEGIN_NAMESPACE
+
+class QPainter;
+class QStyle;
+
+// Renders the theme elements of common controls in the states they reach
+// on interaction (hover, press, focus), at the sizes the controls have in
+// the live widget tree. This happens in short slices from an idle timer,
+// so that input is handled in between.
+class QGtkPrewarmer : public QObject
+{
+public:
+    explicit QGtkPrewarmer(QStyle *style);
+
+    // Looks for controls not seen yet and schedules them
+    void start();
+    // Forgets the controls seen under the previous theme
+    void themeChanged();
+
+private:
+    typedef std::function<void (QPainter *painter)> Job;
+
+    void collect();
+    void runSlice();
+
+    QStyle *m_style;
+    QList<Job> m_jobs;
+    qsizetype m_next;
+    QSet<quint64> m_seen;
+    QImage m_scratch;
+    bool m_scheduled;
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKPREWARMER_P_H
@@ -0,0 +1,216 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtkrenderserver_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QCache>
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QList>
+#include <QMutex>
+#include <QPainter>
+#include <QSharedPointer>
+#include <QThread>
+#include <QWaitCondition>
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    maxKeptRenders = 8 * 1024 * 1024, // bytes of keyed renders kept
+    requestTimeout = 2000, // ms a request waits for the GUI thread
+    waitSlice = 100 // ms between checks for application shutdown
+};
+
+struct QGtkRenderRequest
+{
+    QByteArray key;
+    QSize size;
+    qreal devicePixelRatio = 1.0;
+    std::function<void (QPainter *painter)> paint;
+    std::function<void ()> func;
+    QImage result;
+    bool finished = false;
+    bool cancelled = false;
+};
+
+typedef QSharedPointer<QGtkRenderRequest> QGtkRenderRequestPtr;
+
+struct QGtkRenderQueue
+{
+    QGtkRenderQueue() : kept(maxKeptRenders) {}
+
+    QMutex mutex;
+    QWaitCondition finished;
+    QList<QGtkRenderRequestPtr> pending;
+    bool posted = false;
+    bool stalled = false;
+    QCache<QByteArray, QImage> kept;
+};
+
+Q_GLOBAL_STATIC(QGtkRenderQueue, qt_gtk_render_queue)
+
+static QImage qt_gtk_render_image(const QGtkRenderRequest &request)
+{
+    QImage image(request.size * request.devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull())
+        return image;
+    image.setDevicePixelRatio(request.devicePixelRatio);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    request.paint(&painter);
+    return image;
+}
+
+static void qt_gtk_process_render_queue()
+{
+    QGtkRenderQueue *queue = qt_gtk_render_queue();
+    QList<QGtkRenderRequestPtr> requests;
+    {
+        QMutexLocker locker(&queue->mutex);
+        requests.swap(queue->pending);
+        queue->posted = false;
+        queue->stalled = false;
+    }
+
+    for (const QGtkRenderRequestPtr &request : qAsConst(requests)) {
+        if (request->func)
+            request->func();
+        else
+            request->result = qt_gtk_render_image(*request);
+    }
+
+    QMutexLocker locker(&queue->mutex);
+    for (const QGtkRenderRequestPtr &request : qAsConst(requests)) {
+        request->finished = true;
+        if (!request->key.isEmpty() && !request->result.isNull())
+            queue->kept.insert(request->key, new QImage(request->result), request->result.sizeInBytes());
+    }
+    queue->finished.wakeAll();
+}
+
+// Queues request and waits until the GUI thread has handled it. Keyed
+// requests join a pending one with the same key, the request that was
+// actually served is returned.
+//
+// The GUI thread may itself be waiting for the caller, when it leaves
+// exec() and joins the pool or blocks on a future. A request that the GUI
+// thread has not taken within requestTimeout, or by the time the
+// application closes down, is withdrawn and a null pointer is returned.
+// Until the GUI thread gets to the queue again, later requests are not
+// queued at all. A request that has been taken is always waited for,
+// since the GUI thread is running it and its functions refer to the
+// caller's stack.
+static QGtkRenderRequestPtr qt_gtk_run_request(QGtkRenderRequestPtr request)
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    if (!app || QCoreApplication::closingDown())
+        return QGtkRenderRequestPtr();
+
+    QGtkRenderQueue *queue = qt_gtk_render_queue();
+    QMutexLocker locker(&queue->mutex);
+    if (queue->stalled)
+        return QGtkRenderRequestPtr();
+    bool joined = false;
+    if (!request->key.isEmpty()) {
+        for (const QGtkRenderRequestPtr &pending : qAsConst(queue->pending)) {
+            if (pending->key == request->key) {
+                request = pending;
+                joined = true;
+                break;
+            }
+        }
+    }
+    if (!joined)
+        queue->pending.append(request);
+    if (!queue->posted) {
+        queue->posted = true;
+        QMetaObject::invokeMethod(app, qt_gtk_process_render_queue, Qt::QueuedConnection);
+    }
+    const QDeadlineTimer deadline(requestTimeout);
+    while (!request->finished && !request->cancelled) {
+        if (queue->finished.wait(&queue->mutex, QDeadlineTimer(waitSlice)))
+            continue;
+        if (!deadline.hasExpired() && !QCoreApplication::closingDown())
+            continue;
+        if (queue->pending.removeOne(request)) {
+            request->cancelled = true;
+            queue->stalled = true;
+            queue->finished.wakeAll();
+        }
+    }
+    return request->finished ? request : QGtkRenderRequestPtr();
+}
+
+bool QGtkRenderServer::isGuiThread()
+{
+    QCoreApplication *app = QCoreApplication::instance();
+    return !app || QThread::currentThread() == app->thread();
+}
+
+bool QGtkRenderServer::call(const std::function<void ()> &func)
+{
+    if (isGuiThread()) {
+        func();
+        return true;
+    }
+    QGtkRenderRequestPtr request(new QGtkRenderRequest);
+    request->func = func;
+    return !qt_gtk_run_request(request).isNull();
+}
+
+QImage QGtkRenderServer::render(const QByteArray &key, const QSize &size, qreal devicePixelRatio,
+                                const std::function<void (QPainter *painter)> &paint)
+{
+    if (size.isEmpty())
+        return QImage();
+
+    QGtkRenderQueue *queue = qt_gtk_render_queue();
+    if (!key.isEmpty()) {
+        QMutexLocker locker(&queue->mutex);
+        if (const QImage *image = queue->kept.object(key))
+            return *image;
+    }
+
+    QGtkRenderRequestPtr request(new QGtkRenderRequest);
+    request->key = key;
+    request->size = size;
+    request->devicePixelRatio = devicePixelRatio;
+    request->paint = paint;
+    if (isGuiThread())
+        return qt_gtk_render_image(*request);
+    request = qt_gtk_run_request(request);
+    return request ? request->result : QImage();
+}
+
+void QGtkRenderServer::themeChanged()
+{
+    if (!qt_gtk_render_queue.exists())
+        return;
+    QGtkRenderQueue *queue = qt_gtk_render_queue();
+    QMutexLocker locker(&queue->mutex);
+    queue->kept.clear();
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
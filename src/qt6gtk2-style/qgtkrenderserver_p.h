@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKRENDERSERVER_P_H
+#define QGTKRENDERSERVER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <functional>
+#include <QByteArray>
+#include <QImage>
+
+QT_BEGIN_NAMESPACE
+
+class QPainter;
+
+// Gives other threads access to the style. gtk and gdk are only ever
+// called from the GUI thread, which owns the X connection the engines draw
+// with, so requests from other threads are queued there and the caller
+// waits for them. All requests that arrive before the GUI thread gets to
+// the queue are handled together. Keyed renders are kept, and identical
+// keyed requests pending at the same time are only rendered once.
+//
+// The caller blocks until the GUI thread has processed its request. If the
+// GUI thread does not get to it in time, because it is waiting for the
+// caller or the application is closing down, the request is given up and
+// the caller falls back to QCommonStyle.
+class QGtkRenderServer
+{
+public:
+    static bool isGuiThread();
+
+    // Runs func on the GUI thread and returns once it is done. Returns
+    // false if func was not run.
+    static bool call(const std::function<void ()> &func);
+
+    // Returns an image of size (in device independent pixels) that paint
+    // has drawn into on the GUI thread. A null image is returned if there
+    // is no GUI thread to render on or it did not get to the request.
+    static QImage render(const QByteArray &key, const QSize &size, qreal devicePixelRatio,
+                         const std::function<void (QPainter *painter)> &paint);
+
+    // Drops the kept renders
+    static void themeChanged();
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKRENDERSERVER_P_H
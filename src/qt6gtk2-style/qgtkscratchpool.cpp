@@ -0,0 +1,185 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtkscratchpool_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QCoreApplication>
+#include <QTimer>
+#include <QtMath>
+#include "qgtkshmpixmap_p.h"
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    minimumBucket   = 16,          // smallest surface edge
+    maxPooledArea   = 1024 * 1024, // larger surfaces are not kept
+    maxSurfaces     = 32,          // surfaces kept at most
+    idleTimeout     = 5000         // ms until unused surfaces are dropped
+};
+
+static inline int qt_gtk_bucket(int size)
+{
+    return qMax(int(minimumBucket), int(qNextPowerOfTwo(quint32(size - 1))));
+}
+
+GdkPixbuf *QGtkScratchSurface::pixbuf(int index)
+{
+    if (!pixbufs[index])
+        pixbufs[index] = gdk_pixbuf_new(GDK_COLORSPACE_RGB, true, 8, size.width(), size.height());
+    return pixbufs[index];
+}
+
+GdkImage *QGtkScratchSurface::image()
+{
+    if (!readback)
+        readback = gdk_image_new(GDK_IMAGE_NORMAL, gdk_drawable_get_visual(pixmap), size.width(), size.height());
+    return readback;
+}
+
+QGtkScratchPool::QGtkScratchPool() : m_trimScheduled(false)
+{
+    m_clock.start();
+}
+
+QGtkScratchSurface *QGtkScratchPool::acquire(GtkWidget *window, const QSize &size)
+{
+    const QSize bucket(qt_gtk_bucket(size.width()), qt_gtk_bucket(size.height()));
+    for (QGtkScratchSurface *surface : qAsConst(m_surfaces)) {
+        if (!surface->inUse && surface->window == window && surface->size == bucket) {
+            surface->inUse = true;
+            return surface;
+        }
+    }
+
+    QGtkScratchSurface *surface = new QGtkScratchSurface;
+    surface->window = window;
+    surface->size = bucket;
+    surface->shm = QGtkShmPixmap::create(window->window, bucket);
+    if (surface->shm)
+        surface->pixmap = surface->shm->pixmap();
+    else
+        surface->pixmap = gdk_pixmap_new((GdkDrawable*)(window->window), bucket.width(), bucket.height(), -1);
+    if (!surface->pixmap) {
+        delete surface;
+        return nullptr;
+    }
+    surface->inUse = true;
+    m_surfaces.append(surface);
+    return surface;
+}
+
+void QGtkScratchPool::release(QGtkScratchSurface *surface)
+{
+    surface->inUse = false;
+    surface->lastUsed = m_clock.elapsed();
+
+    if (surface->size.width() * surface->size.height() > maxPooledArea) {
+        m_surfaces.removeOne(surface);
+        destroySurface(surface);
+    } else if (m_surfaces.size() > maxSurfaces) {
+        int oldest = -1;
+        for (int i = 0; i < m_surfaces.size(); ++i) {
+            if (!m_surfaces.at(i)->inUse && (oldest < 0 || m_surfaces.at(i)->lastUsed < m_surfaces.at(oldest)->lastUsed))
+                oldest = i;
+        }
+        if (oldest >= 0)
+            destroySurface(m_surfaces.takeAt(oldest));
+    }
+    scheduleTrim();
+}
+
+// gtk_style_attach() has to be balanced with gtk_style_detach(),
+// so every style is attached only once per window. When the colormap
+// differs, attaching returns a copy and moves the reference passed in
+// over to it. The key keeps a reference of its own, so that its address
+// is not reused while it is in the table.
+GtkStyle *QGtkScratchPool::attachStyle(GtkWidget *window, GtkStyle *style)
+{
+    const QPair<GtkWidget *, GtkStyle *> key(window, style);
+    GtkStyle *attached = m_attachedStyles.value(key);
+    if (!attached) {
+        g_object_ref(style); // for the key
+        g_object_ref(style); // taken over by the attached style
+        attached = gtk_style_attach(style, window->window);
+        m_attachedStyles.insert(key, attached);
+    }
+    return attached;
+}
+
+// Drops the surfaces which have not been used for a while
+void QGtkScratchPool::trim()
+{
+    const qint64 now = m_clock.elapsed();
+    for (int i = m_surfaces.size() - 1; i >= 0; --i) {
+        QGtkScratchSurface *surface = m_surfaces.at(i);
+        if (!surface->inUse && now - surface->lastUsed >= idleTimeout)
+            destroySurface(m_surfaces.takeAt(i));
+    }
+    if (!m_surfaces.isEmpty())
+        scheduleTrim();
+}
+
+// Releases everything that depends on the current theme
+void QGtkScratchPool::clear()
+{
+    for (int i = m_surfaces.size() - 1; i >= 0; --i) {
+        if (!m_surfaces.at(i)->inUse)
+            destroySurface(m_surfaces.takeAt(i));
+    }
+    for (auto it = m_attachedStyles.cbegin(); it != m_attachedStyles.cend(); ++it) {
+        gtk_style_detach(it.value());
+        g_object_unref(it.value());
+        g_object_unref(it.key().second);
+    }
+    m_attachedStyles.clear();
+}
+
+void QGtkScratchPool::destroySurface(QGtkScratchSurface *surface)
+{
+    if (surface->shm)
+        delete surface->shm;
+    else
+        g_object_unref(surface->pixmap);
+    for (GdkPixbuf *pixbuf : surface->pixbufs) {
+        if (pixbuf)
+            g_object_unref(pixbuf);
+    }
+    if (surface->readback)
+        g_object_unref(surface->readback);
+    delete surface;
+}
+
+void QGtkScratchPool::scheduleTrim()
+{
+    if (m_trimScheduled || !QCoreApplication::instance())
+        return;
+    m_trimScheduled = true;
+    QTimer::singleShot(idleTimeout, QCoreApplication::instance(), [this] {
+        m_trimScheduled = false;
+        trim();
+    });
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
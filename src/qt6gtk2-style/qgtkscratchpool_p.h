@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKSCRATCHPOOL_P_H
+#define QGTKSCRATCHPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QSize>
+#include <QList>
+#include <QHash>
+#include <QPair>
+#include <QElapsedTimer>
+#include "qgtkglobal_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QGtkShmPixmap;
+
+// An offscreen drawable the theme engine renders into. Its size is
+// rounded up to a power of two, only the top left part is used.
+class QGtkScratchSurface
+{
+public:
+    GdkPixbuf *pixbuf(int index);
+    GdkImage *image();
+
+    GtkWidget *window = nullptr;     // provides visual and colormap
+    QSize size;
+    GdkPixmap *pixmap = nullptr;
+    QGtkShmPixmap *shm = nullptr;    // shared memory backing, if any
+    GdkPixbuf *pixbufs[2] = { nullptr, nullptr };
+    GdkImage *readback = nullptr;
+    qint64 lastUsed = 0;
+    bool inUse = false;
+};
+
+// Keeps scratch surfaces and attached styles around between cache
+// misses, so that rendering does not allocate server side resources
+// each time.
+class QGtkScratchPool
+{
+public:
+    QGtkScratchPool();
+
+    QGtkScratchSurface *acquire(GtkWidget *window, const QSize &size);
+    void release(QGtkScratchSurface *surface);
+    GtkStyle *attachStyle(GtkWidget *window, GtkStyle *style);
+
+    void trim();
+    void clear();
+
+private:
+    Q_DISABLE_COPY(QGtkScratchPool)
+
+    void destroySurface(QGtkScratchSurface *surface);
+    void scheduleTrim();
+
+    QList<QGtkScratchSurface *> m_surfaces;
+    QHash<QPair<GtkWidget *, GtkStyle *>, GtkStyle *> m_attachedStyles;
+    QElapsedTimer m_clock;
+    bool m_trimScheduled;
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKSCRATCHPOOL_P_H
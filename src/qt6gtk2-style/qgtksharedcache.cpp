@@ -0,0 +1,298 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtksharedcache_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QAtomicInteger>
+#include <QtEndian>
+#include "qgtkdiskcache_p.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+enum {
+    sharedFormatVersion = 1,
+    digestSize          = 16,
+    slotCount           = 8192,
+    maxProbes           = 32,
+    segmentSize         = 32 * 1024 * 1024,
+    dataAlignment       = 16,
+    maxIndexName        = 128
+};
+
+static const char qt_gtk_shared_magic[8] = { 'Q', 'T', 'G', 'T', 'K', '2', 'S', 'C' };
+
+struct QGtkSharedCacheHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 slotCount;
+    quint32 segmentSize;
+    QBasicAtomicInteger<quint32> dataUsed;  // end of the data, only written under the lock
+    uchar identity[digestSize];
+};
+
+// A slot is taken once its offset is set, which happens last
+struct QGtkSharedCacheSlot
+{
+    QBasicAtomicInteger<quint32> offset;
+    quint16 width;
+    quint16 height;
+    quint32 format;
+    uchar digest[digestSize];
+};
+
+static const quint32 qt_gtk_data_start = (sizeof(QGtkSharedCacheHeader)
+                                          + slotCount * sizeof(QGtkSharedCacheSlot)
+                                          + dataAlignment - 1) & ~quint32(dataAlignment - 1);
+
+class QGtkSharedCacheData
+{
+public:
+    QGtkSharedCacheData()
+        : enabled(qEnvironmentVariableIsSet("QT6GTK2_SHARED_CACHE")), attached(false), fd(-1), base(nullptr)
+    {}
+
+    QGtkSharedCacheHeader *header() const { return reinterpret_cast<QGtkSharedCacheHeader *>(base); }
+    QGtkSharedCacheSlot *slots() const
+    {
+        return reinterpret_cast<QGtkSharedCacheSlot *>(base + sizeof(QGtkSharedCacheHeader));
+    }
+
+    bool enabled;
+    bool attached;
+    QByteArray name;
+    int fd;
+    uchar *base;
+};
+
+Q_GLOBAL_STATIC(QGtkSharedCacheData, qt_gtk_shared_cache)
+
+static void qt_gtk_detach_shared(QGtkSharedCacheData *d)
+{
+    if (d->base)
+        munmap(d->base, segmentSize);
+    if (d->fd >= 0)
+        ::close(d->fd);
+    d->base = nullptr;
+    d->fd = -1;
+    d->attached = false;
+}
+
+static bool qt_gtk_is_valid_header(const QGtkSharedCacheHeader *header, const QByteArray &identity)
+{
+    const quint32 used = header->dataUsed.loadAcquire();
+    return memcmp(header->magic, qt_gtk_shared_magic, sizeof(header->magic)) == 0
+           && header->version == sharedFormatVersion
+           && header->slotCount == slotCount
+           && header->segmentSize == segmentSize
+           && memcmp(header->identity, identity.constData(), digestSize) == 0
+           && used >= qt_gtk_data_start && used <= quint32(segmentSize);
+}
+
+// The index segment of a user holds the name of the segment attached to
+// last. Attaching to another one unlinks that, so segments of themes,
+// gtkrc files or plugin versions that are no longer used do not pile up.
+// Processes still attached keep their mapping.
+static void qt_gtk_prune_shared(const QByteArray &prefix, const QByteArray &name)
+{
+    const QByteArray indexName = prefix + "index";
+    const int fd = shm_open(indexName.constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return;
+    struct stat info;
+    if (flock(fd, LOCK_EX) == 0) {
+        if (fstat(fd, &info) == 0 && info.st_uid == getuid()) {
+            char buffer[maxIndexName] = {};
+            const ssize_t length = pread(fd, buffer, sizeof(buffer) - 1, 0);
+            const QByteArray previous(buffer, length > 0 ? int(length) : 0);
+            if (previous != name) {
+                if (previous.startsWith(prefix) && previous != indexName)
+                    shm_unlink(previous.constData());
+                if (ftruncate(fd, 0) != 0
+                        || pwrite(fd, name.constData(), size_t(name.size()), 0) != ssize_t(name.size()))
+                    shm_unlink(indexName.constData());
+            }
+        }
+        flock(fd, LOCK_UN);
+    }
+    ::close(fd);
+}
+
+// There is one segment per user and theme. Whoever comes first sets it up,
+// the file lock keeps the others out until the header is written.
+static void qt_gtk_attach_shared(QGtkSharedCacheData *d)
+{
+    d->attached = true;
+    const QByteArray identity = QGtkDiskCache::themeIdentity();
+    const QByteArray prefix = "/qt6gtk2-" + QByteArray::number(getuid()) + '-';
+    d->name = prefix + identity.toHex();
+    qt_gtk_prune_shared(prefix, d->name);
+
+    d->fd = shm_open(d->name.constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (d->fd < 0)
+        return;
+    if (flock(d->fd, LOCK_EX) != 0) {
+        qt_gtk_detach_shared(d);
+        d->attached = true;
+        return;
+    }
+
+    struct stat info;
+    bool ok = fstat(d->fd, &info) == 0 && info.st_uid == getuid();
+    const bool created = ok && info.st_size == 0;
+    if (created)
+        ok = ftruncate(d->fd, segmentSize) == 0;
+    else if (ok)
+        ok = info.st_size == segmentSize;
+    if (ok) {
+        void *base = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, d->fd, 0);
+        d->base = base != MAP_FAILED ? static_cast<uchar *>(base) : nullptr;
+        ok = d->base;
+    }
+    if (ok && created) {
+        QGtkSharedCacheHeader *header = d->header();
+        memcpy(header->magic, qt_gtk_shared_magic, sizeof(header->magic));
+        header->version = sharedFormatVersion;
+        header->slotCount = slotCount;
+        header->segmentSize = segmentSize;
+        memcpy(header->identity, identity.constData(), digestSize);
+        header->dataUsed.storeRelease(qt_gtk_data_start);
+    }
+    ok = ok && qt_gtk_is_valid_header(d->header(), identity);
+    flock(d->fd, LOCK_UN);
+
+    if (!ok) {
+        // damaged or not ours, keep to the per-process caches
+        qt_gtk_detach_shared(d);
+        d->attached = true;
+    }
+}
+
+static inline quint32 qt_gtk_first_slot(const QByteArray &digest)
+{
+    return qFromUnaligned<quint32>(digest.constData()) % slotCount;
+}
+
+bool QGtkSharedCache::isEnabled()
+{
+    return qt_gtk_shared_cache()->enabled;
+}
+
+bool QGtkSharedCache::find(const QByteArray &digest, QPixmap *pixmap)
+{
+    if (digest.size() != digestSize || !isEnabled())
+        return false;
+    QGtkSharedCacheData *d = qt_gtk_shared_cache();
+    if (!d->attached)
+        qt_gtk_attach_shared(d);
+    if (!d->base)
+        return false;
+
+    const quint32 first = qt_gtk_first_slot(digest);
+    for (quint32 probe = 0; probe < maxProbes; ++probe) {
+        const QGtkSharedCacheSlot &slot = d->slots()[(first + probe) % slotCount];
+        const quint32 offset = slot.offset.loadAcquire();
+        if (!offset)
+            return false;
+        if (memcmp(slot.digest, digest.constData(), digestSize) != 0)
+            continue;
+
+        const QImage::Format format = QImage::Format(slot.format);
+        const quint32 bytes = quint32(slot.width) * slot.height * 4;
+        if ((format != QImage::Format_ARGB32_Premultiplied && format != QImage::Format_RGB32)
+                || offset < qt_gtk_data_start || offset > quint32(segmentSize)
+                || bytes > quint32(segmentSize) - offset)
+            return false;
+        const QImage image(d->base + offset, slot.width, slot.height, slot.width * 4, format);
+        *pixmap = QPixmap::fromImage(image.copy());
+        return !pixmap->isNull();
+    }
+    return false;
+}
+
+bool QGtkSharedCache::insert(const QByteArray &digest, const QImage &image)
+{
+    if (digest.size() != digestSize || image.isNull() || !isEnabled()
+            || image.width() > 0xffff || image.height() > 0xffff)
+        return false;
+    QGtkSharedCacheData *d = qt_gtk_shared_cache();
+    if (!d->attached)
+        qt_gtk_attach_shared(d);
+    if (!d->base || flock(d->fd, LOCK_EX) != 0)
+        return false;
+
+    bool inserted = false;
+    QGtkSharedCacheHeader *header = d->header();
+    const quint32 first = qt_gtk_first_slot(digest);
+    for (quint32 probe = 0; probe < maxProbes; ++probe) {
+        QGtkSharedCacheSlot &slot = d->slots()[(first + probe) % slotCount];
+        if (slot.offset.loadAcquire()) {
+            if (memcmp(slot.digest, digest.constData(), digestSize) == 0)
+                break;
+            continue;
+        }
+
+        const QImage converted = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                               : QImage::Format_RGB32);
+        const quint32 lineBytes = quint32(converted.width()) * 4;
+        const quint32 bytes = lineBytes * converted.height();
+        const quint32 offset = header->dataUsed.loadRelaxed();
+        if (bytes > quint32(segmentSize) - offset)
+            break; // full
+        for (int y = 0; y < converted.height(); ++y)
+            memcpy(d->base + offset + y * lineBytes, converted.constScanLine(y), lineBytes);
+        slot.width = quint16(converted.width());
+        slot.height = quint16(converted.height());
+        slot.format = quint32(converted.format());
+        memcpy(slot.digest, digest.constData(), digestSize);
+        header->dataUsed.storeRelease((offset + bytes + dataAlignment - 1) & ~quint32(dataAlignment - 1));
+        slot.offset.storeRelease(offset);
+        inserted = true;
+        break;
+    }
+
+    flock(d->fd, LOCK_UN);
+    return inserted;
+}
+
+// The segment of the old theme is left to the processes still attached
+// to it, new ones will not find it anymore
+void QGtkSharedCache::themeChanged()
+{
+    if (!qt_gtk_shared_cache.exists())
+        return;
+    QGtkSharedCacheData *d = qt_gtk_shared_cache();
+    if (d->base)
+        shm_unlink(d->name.constData());
+    qt_gtk_detach_shared(d);
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
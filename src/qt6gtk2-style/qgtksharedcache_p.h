@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKSHAREDCACHE_P_H
+#define QGTKSHAREDCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QByteArray>
+#include <QImage>
+#include <QPixmap>
+
+QT_BEGIN_NAMESPACE
+
+// Rendered theme elements in a POSIX shared memory segment that all
+// processes of the user using the same theme attach to. Elements are keyed
+// by QGtkDiskCache::digest(). Lookups take no lock, elements are only ever
+// appended, under a file lock on the segment. When the segment is full or
+// damaged the process keeps to its own caches. The segment of the theme
+// used before is unlinked on attach. Only to be used from the GUI thread.
+class QGtkSharedCache
+{
+public:
+    static bool isEnabled();
+
+    static bool find(const QByteArray &digest, QPixmap *pixmap);
+    static bool insert(const QByteArray &digest, const QImage &image);
+
+    static void themeChanged();
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKSHAREDCACHE_P_H
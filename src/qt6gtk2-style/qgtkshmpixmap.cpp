@@ -0,0 +1,165 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtkshmpixmap_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <gdk/gdkx.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+// -1: not checked yet, 0: unusable, 1: usable
+static int qt_gtk_shm_state = -1;
+
+static bool qt_gtk_check_shm(Display *display)
+{
+    if (qEnvironmentVariableIsSet("QT6GTK2_NO_SHM"))
+        return false;
+
+    // Shared memory only works with a server on this machine
+    const char *name = DisplayString(display);
+    if (!name || (name[0] != ':' && strncmp(name, "unix:", 5) != 0))
+        return false;
+
+    int major = 0, minor = 0;
+    Bool pixmaps = False;
+    if (!XShmQueryExtension(display) || !XShmQueryVersion(display, &major, &minor, &pixmaps) || !pixmaps)
+        return false;
+    if (XShmPixmapFormat(display) != ZPixmap)
+        return false;
+    return ImageByteOrder(display) == ((Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? LSBFirst : MSBFirst);
+}
+
+static int qt_gtk_bits_per_pixel(Display *display, int depth)
+{
+    int count = 0;
+    int bitsPerPixel = 0;
+    XPixmapFormatValues *formats = XListPixmapFormats(display, &count);
+    for (int i = 0; i < count; ++i) {
+        if (formats[i].depth == depth)
+            bitsPerPixel = formats[i].bits_per_pixel;
+    }
+    if (formats)
+        XFree(formats);
+    return bitsPerPixel;
+}
+
+bool QGtkShmPixmap::isAvailable(GdkDrawable *drawable)
+{
+    Display *display = GDK_DRAWABLE_XDISPLAY(drawable);
+    if (qt_gtk_shm_state < 0)
+        qt_gtk_shm_state = qt_gtk_check_shm(display) ? 1 : 0;
+    if (!qt_gtk_shm_state)
+        return false;
+
+    GdkVisual *visual = gdk_drawable_get_visual(drawable);
+    return visual && visual->type == GDK_VISUAL_TRUE_COLOR
+            && (visual->depth == 24 || visual->depth == 32)
+            && visual->red_mask == 0xff0000 && visual->green_mask == 0xff00 && visual->blue_mask == 0xff
+            && qt_gtk_bits_per_pixel(display, visual->depth) == 32;
+}
+
+QGtkShmPixmap *QGtkShmPixmap::create(GdkDrawable *drawable, const QSize &size)
+{
+    if (size.isEmpty() || !isAvailable(drawable))
+        return nullptr;
+
+    Display *display = GDK_DRAWABLE_XDISPLAY(drawable);
+    const int bytesPerLine = size.width() * 4;
+
+    XShmSegmentInfo info;
+    info.shmid = shmget(IPC_PRIVATE, size_t(bytesPerLine) * size.height(), IPC_CREAT | 0600);
+    if (info.shmid < 0)
+        return nullptr;
+    info.shmaddr = (char *)shmat(info.shmid, nullptr, 0);
+    info.readOnly = False;
+    if (info.shmaddr == (char *)-1) {
+        shmctl(info.shmid, IPC_RMID, nullptr);
+        return nullptr;
+    }
+
+    gdk_error_trap_push();
+    XShmAttach(display, &info);
+    XSync(display, False);
+    const bool attached = !gdk_error_trap_pop();
+    // The segment is released as soon as both sides have detached
+    shmctl(info.shmid, IPC_RMID, nullptr);
+    if (!attached) {
+        shmdt(info.shmaddr);
+        qt_gtk_shm_state = 0;
+        return nullptr;
+    }
+
+    Pixmap xpixmap = XShmCreatePixmap(display, GDK_DRAWABLE_XID(drawable), info.shmaddr, &info,
+                                      size.width(), size.height(), gdk_drawable_get_depth(drawable));
+    GdkPixmap *pixmap = gdk_pixmap_foreign_new_for_display(gdk_drawable_get_display(drawable), xpixmap);
+    if (!pixmap) {
+        XFreePixmap(display, xpixmap);
+        XShmDetach(display, &info);
+        XSync(display, False);
+        shmdt(info.shmaddr);
+        return nullptr;
+    }
+    // Foreign pixmaps have no colormap, which gdk needs for GCs and cairo
+    gdk_drawable_set_colormap(pixmap, gdk_drawable_get_colormap(drawable));
+
+    QGtkShmPixmap *shmPixmap = new QGtkShmPixmap;
+    shmPixmap->m_display = display;
+    shmPixmap->m_pixmap = pixmap;
+    shmPixmap->m_size = size;
+    shmPixmap->m_data = (uchar *)info.shmaddr;
+    shmPixmap->m_bytesPerLine = bytesPerLine;
+    shmPixmap->m_shmId = info.shmid;
+    shmPixmap->m_shmSeg = info.shmseg;
+    shmPixmap->m_xpixmap = xpixmap;
+    return shmPixmap;
+}
+
+QGtkShmPixmap::~QGtkShmPixmap()
+{
+    // foreign pixmaps do not free the X pixmap on their own
+    g_object_unref(m_pixmap);
+    XFreePixmap(m_display, m_xpixmap);
+
+    XShmSegmentInfo info;
+    info.shmseg = m_shmSeg;
+    info.shmid = m_shmId;
+    info.shmaddr = (char *)m_data;
+    info.readOnly = False;
+    XShmDetach(m_display, &info);
+    XSync(m_display, False);
+    shmdt(m_data);
+}
+
+// Waits until the X server has executed all drawing requests
+void QGtkShmPixmap::sync() const
+{
+    XSync(m_display, False);
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
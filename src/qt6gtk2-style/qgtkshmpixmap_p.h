@@ -0,0 +1,83 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKSHMPIXMAP_P_H
+#define QGTKSHMPIXMAP_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QSize>
+#include "qgtkglobal_p.h"
+
+typedef struct _XDisplay Display;
+
+QT_BEGIN_NAMESPACE
+
+// A GdkPixmap living in a MIT-SHM segment. The theme engine draws
+// into it like into any other pixmap, while the rendered pixels can be
+// read from shared memory without an XGetImage round-trip. The pixels
+// use the native 32 bit layout of the X visual, which matches
+// QImage::Format_RGB32 and QImage::Format_ARGB32_Premultiplied.
+class QGtkShmPixmap
+{
+public:
+    ~QGtkShmPixmap();
+
+    static bool isAvailable(GdkDrawable *drawable);
+    static QGtkShmPixmap *create(GdkDrawable *drawable, const QSize &size);
+
+    GdkPixmap *pixmap() const { return m_pixmap; }
+    QSize size() const { return m_size; }
+    int bytesPerLine() const { return m_bytesPerLine; }
+    const uchar *constScanLine(int y) const { return m_data + y * m_bytesPerLine; }
+
+    void sync() const;
+
+private:
+    QGtkShmPixmap() = default;
+    Q_DISABLE_COPY(QGtkShmPixmap)
+
+    Display *m_display = nullptr;
+    GdkPixmap *m_pixmap = nullptr;
+    QSize m_size;
+    uchar *m_data = nullptr;
+    int m_bytesPerLine = 0;
+    int m_shmId = -1;
+    unsigned long m_shmSeg = 0;
+    unsigned long m_xpixmap = 0;
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKSHMPIXMAP_P_H
@@ -0,0 +1,226 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtkstats_p.h"
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QList>
+#include <QMetaEnum>
+#include <QSocketNotifier>
+#include <QStyle>
+#include <algorithm>
+#include "qgtkpixmapcache_p.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_LOGGING_CATEGORY(lcQGtkStats, "qt6gtk2.stats")
+
+bool QGtkStats::enabled = false;
+
+struct QGtkStatsBucket
+{
+    int kind;
+    int element;
+    const char *detail;
+};
+
+static inline bool operator==(const QGtkStatsBucket &a, const QGtkStatsBucket &b)
+{
+    return a.kind == b.kind && a.element == b.element && a.detail == b.detail;
+}
+
+static inline size_t qHash(const QGtkStatsBucket &bucket, size_t seed = 0)
+{
+    return qHashMulti(seed, bucket.kind, bucket.element, quintptr(bucket.detail));
+}
+
+struct QGtkStatsCounters
+{
+    quint64 calls = 0;
+    quint64 hits = 0;
+    quint64 misses = 0;
+    qint64 paintTime = 0;
+    qint64 renderTime = 0;
+    qint64 readBackTime = 0;
+    quint64 bytes = 0;
+    quint64 evictions = 0;
+};
+
+struct QGtkStatsData
+{
+    QHash<QGtkStatsBucket, QGtkStatsCounters> buckets;
+    QGtkStats::Kind kind = QGtkStats::Other;
+    int element = -1;
+    const char *detail = nullptr; // of the last miss, renders are booked on it
+};
+
+Q_GLOBAL_STATIC(QGtkStatsData, qt_gtk_stats)
+
+static int qt_gtk_stats_pipe[2] = { -1, -1 };
+
+static void qt_gtk_stats_signal(int)
+{
+    const char c = 0;
+    ssize_t ignored = write(qt_gtk_stats_pipe[1], &c, 1);
+    Q_UNUSED(ignored);
+}
+
+static QGtkStatsCounters &qt_gtk_stats_bucket(const char *detail)
+{
+    QGtkStatsData *d = qt_gtk_stats();
+    return d->buckets[QGtkStatsBucket{ d->kind, d->element, detail }];
+}
+
+void QGtkStats::init()
+{
+    static bool initialized = false;
+    if (initialized)
+        return;
+    initialized = true;
+
+    const bool dump = qEnvironmentVariableIsSet("QT6GTK2_STATS");
+    enabled = dump || lcQGtkStats().isDebugEnabled();
+    if (!dump)
+        return;
+
+    lcQGtkStats().setEnabled(QtInfoMsg, true);
+    qAddPostRoutine(QGtkStats::dump);
+    if (QCoreApplication::instance() && pipe2(qt_gtk_stats_pipe, O_CLOEXEC | O_NONBLOCK) == 0) {
+        QSocketNotifier *notifier = new QSocketNotifier(qt_gtk_stats_pipe[0], QSocketNotifier::Read,
+                                                        QCoreApplication::instance());
+        QObject::connect(notifier, &QSocketNotifier::activated, []() {
+            char buffer[16];
+            while (read(qt_gtk_stats_pipe[0], buffer, sizeof(buffer)) > 0) {}
+            QGtkStats::dump();
+        });
+        struct sigaction action = {};
+        action.sa_handler = qt_gtk_stats_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR1, &action, nullptr);
+    }
+}
+
+void QGtkStats::enter(Kind kind, int element, Kind *previousKind, int *previousElement)
+{
+    QGtkStatsData *d = qt_gtk_stats();
+    *previousKind = d->kind;
+    *previousElement = d->element;
+    d->kind = kind;
+    d->element = element;
+    d->detail = nullptr;
+    ++d->buckets[QGtkStatsBucket{ kind, element, nullptr }].calls;
+}
+
+void QGtkStats::leave(Kind previousKind, int previousElement, qint64 nsecs)
+{
+    QGtkStatsData *d = qt_gtk_stats();
+    d->buckets[QGtkStatsBucket{ d->kind, d->element, nullptr }].paintTime += nsecs;
+    d->kind = previousKind;
+    d->element = previousElement;
+    d->detail = nullptr;
+}
+
+void QGtkStats::hit(const QGtkPixmapKey &key)
+{
+    ++qt_gtk_stats_bucket(reinterpret_cast<const char *>(quintptr(key.detail))).hits;
+}
+
+void QGtkStats::miss(const QGtkPixmapKey &key)
+{
+    const char *detail = reinterpret_cast<const char *>(quintptr(key.detail));
+    qt_gtk_stats()->detail = detail;
+    ++qt_gtk_stats_bucket(detail).misses;
+}
+
+void QGtkStats::elapsed(Timing timing, qint64 nsecs)
+{
+    QGtkStatsCounters &counters = qt_gtk_stats_bucket(qt_gtk_stats()->detail);
+    if (timing == Render)
+        counters.renderTime += nsecs;
+    else
+        counters.readBackTime += nsecs;
+}
+
+void QGtkStats::cached(qsizetype bytes, qsizetype evictions)
+{
+    QGtkStatsCounters &counters = qt_gtk_stats_bucket(qt_gtk_stats()->detail);
+    counters.bytes += quint64(bytes);
+    counters.evictions += quint64(evictions);
+}
+
+static QByteArray qt_gtk_stats_element(int kind, int element)
+{
+    const char *name = nullptr;
+    switch (kind) {
+    case QGtkStats::Primitive:
+        name = QMetaEnum::fromType<QStyle::PrimitiveElement>().valueToKey(element);
+        break;
+    case QGtkStats::Control:
+        name = QMetaEnum::fromType<QStyle::ControlElement>().valueToKey(element);
+        break;
+    case QGtkStats::ComplexControl:
+        name = QMetaEnum::fromType<QStyle::ComplexControl>().valueToKey(element);
+        break;
+    default:
+        return QByteArrayLiteral("(other)");
+    }
+    return name ? QByteArray(name) : QByteArray::number(element);
+}
+
+// Prints one line per element and detail, the most expensive first. Time
+// columns are in milliseconds, paint time includes nested elements. Batch
+// readbacks are booked on the element that ends the batch.
+void QGtkStats::dump()
+{
+    if (!enabled || !qt_gtk_stats.exists())
+        return;
+
+    typedef QPair<QGtkStatsBucket, QGtkStatsCounters> Row;
+    QList<Row> rows;
+    const QHash<QGtkStatsBucket, QGtkStatsCounters> &buckets = qt_gtk_stats()->buckets;
+    for (auto it = buckets.constBegin(); it != buckets.constEnd(); ++it)
+        rows.append(qMakePair(it.key(), it.value()));
+    std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) {
+        return qMax(a.second.paintTime, a.second.renderTime) > qMax(b.second.paintTime, b.second.renderTime);
+    });
+
+    qCInfo(lcQGtkStats, "%-28s %-18s %8s %8s %8s %10s %10s %10s %10s %8s", "element", "detail",
+           "calls", "hits", "misses", "paint ms", "gtk ms", "readback", "cached KB", "evicted");
+    for (const Row &row : qAsConst(rows)) {
+        const QGtkStatsCounters &c = row.second;
+        qCInfo(lcQGtkStats, "%-28s %-18s %8llu %8llu %8llu %10.2f %10.2f %10.2f %10llu %8llu",
+               qt_gtk_stats_element(row.first.kind, row.first.element).constData(),
+               row.first.detail ? row.first.detail : "-",
+               c.calls, c.hits, c.misses, c.paintTime / 1e6, qMax<qint64>(0, c.renderTime - c.readBackTime) / 1e6,
+               c.readBackTime / 1e6, c.bytes / 1024, c.evictions);
+    }
+}
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_GTK)
@@ -0,0 +1,137 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKSTATS_P_H
+#define QGTKSTATS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtGlobal>
+#if !defined(QT_NO_STYLE_GTK)
+
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+QT_BEGIN_NAMESPACE
+
+Q_DECLARE_LOGGING_CATEGORY(lcQGtkStats)
+
+struct QGtkPixmapKey;
+
+// Paint statistics broken down by style element and gtk detail. Nothing
+// is recorded unless QT6GTK2_STATS is set or the qt6gtk2.stats category
+// is enabled for debug output, and then only on the GUI thread. With
+// QT6GTK2_STATS the table is printed at exit and on SIGUSR1.
+class QGtkStats
+{
+public:
+    enum Kind
+    {
+        Primitive,
+        Control,
+        ComplexControl,
+        Other
+    };
+
+    enum Timing
+    {
+        Render,     // whole render of a cache miss, readback included
+        ReadBack    // transfer of rendered pixels from the X server
+    };
+
+    static void init();
+    static inline bool isEnabled() { return enabled; }
+
+    static void enter(Kind kind, int element, Kind *previousKind, int *previousElement);
+    static void leave(Kind previousKind, int previousElement, qint64 nsecs);
+    static void hit(const QGtkPixmapKey &key);
+    static void miss(const QGtkPixmapKey &key);
+    static void elapsed(Timing timing, qint64 nsecs);
+    static void cached(qsizetype bytes, qsizetype evictions);
+
+    static void dump();
+
+private:
+    static bool enabled;
+};
+
+// Counts a style call and its time for the element while in scope
+class QGtkStatsScope
+{
+public:
+    QGtkStatsScope(QGtkStats::Kind kind, int element) : m_active(QGtkStats::isEnabled())
+    {
+        if (m_active) {
+            QGtkStats::enter(kind, element, &m_previousKind, &m_previousElement);
+            m_timer.start();
+        }
+    }
+    ~QGtkStatsScope()
+    {
+        if (m_active)
+            QGtkStats::leave(m_previousKind, m_previousElement, m_timer.nsecsElapsed());
+    }
+
+private:
+    Q_DISABLE_COPY(QGtkStatsScope)
+
+    bool m_active;
+    QGtkStats::Kind m_previousKind = QGtkStats::Other;
+    int m_previousElement = -1;
+    QElapsedTimer m_timer;
+};
+
+// Adds the time spent in scope to timing
+class QGtkStatsTimer
+{
+public:
+    explicit QGtkStatsTimer(QGtkStats::Timing timing) : m_timing(timing), m_active(QGtkStats::isEnabled())
+    {
+        if (m_active)
+            m_timer.start();
+    }
+    ~QGtkStatsTimer()
+    {
+        if (m_active)
+            QGtkStats::elapsed(m_timing, m_timer.nsecsElapsed());
+    }
+
+private:
+    Q_DISABLE_COPY(QGtkStatsTimer)
+
+    QGtkStats::Timing m_timing;
+    bool m_active;
+    QElapsedTimer m_timer;
+};
+
+QT_END_NAMESPACE
+
+#endif //!defined(QT_NO_STYLE_QGTK)
+
+#endif // QGTKSTATS_P_H
@@ -47,10 +47,12 @@
 #include <QStyledItemDelegate>
 #include <QWizard>
 
-#include <QPixmapCache>
 #include <private/qstyleanimation_p.h>
 #undef signals // Collides with GTK stymbols
 #include "qgtkpainter_p.h"
+#include "qgtkprewarmer_p.h"
+#include "qgtkrenderserver_p.h"
+#include "qgtkstats_p.h"
 #include "qstylehelper_p.h"
 #include "qgtkstyle_p_p.h"
 
@@ -264,6 +266,70 @@ static GdkColor fromQColor(const QColor &color)
     return retval;
 }
 
+// Primitives that only depend on the fields hashed by qt_gtk_render_key()
+// when drawn without a widget
+static bool qt_gtk_keep_primitive(QStyle::PrimitiveElement element)
+{
+    switch (element) {
+    case QStyle::PE_PanelButtonCommand:
+    case QStyle::PE_PanelLineEdit:
+    case QStyle::PE_IndicatorCheckBox:
+    case QStyle::PE_IndicatorRadioButton:
+    case QStyle::PE_IndicatorArrowUp:
+    case QStyle::PE_IndicatorArrowDown:
+    case QStyle::PE_IndicatorArrowLeft:
+    case QStyle::PE_IndicatorArrowRight:
+    case QStyle::PE_FrameFocusRect:
+    case QStyle::PE_PanelMenu:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static QByteArray qt_gtk_render_key(char kind, int element, const QStyleOption *option, qreal devicePixelRatio)
+{
+    qint64 features = 0;
+    qint64 lineWidth = 0;
+    if (const QStyleOptionButton *button = qstyleoption_cast<const QStyleOptionButton *>(option)) {
+        features = button->features;
+    } else if (const QStyleOptionFrame *frame = qstyleoption_cast<const QStyleOptionFrame *>(option)) {
+        features = frame->features;
+        lineWidth = (qint64(frame->lineWidth) << 32) | quint32(frame->midLineWidth);
+    }
+    const qint64 fields[] = {
+        kind, element, option->type, option->version, qint64(option->state), option->direction,
+        option->rect.width(), option->rect.height(), qint64(option->palette.cacheKey()),
+        qRound64(devicePixelRatio * 100), features, lineWidth
+    };
+    return QByteArray(reinterpret_cast<const char *>(fields), sizeof(fields));
+}
+
+// Draws for a thread other than the GUI thread. The element is rendered by
+// the GUI thread into an image covering the option rectangle.
+// Returns false if the GUI thread did not get to the paint
+static bool qt_gtk_draw_marshaled(char kind, int element, bool keep, const QStyleOption *option,
+                                  QPainter *painter, const std::function<void (QPainter *)> &paint)
+{
+    const QRect rect = option->rect;
+    if (rect.isEmpty())
+        return true;
+    const qreal devicePixelRatio = painter->device() ? painter->device()->devicePixelRatio() : qreal(1);
+    const QByteArray key = keep ? qt_gtk_render_key(kind, element, option, devicePixelRatio) : QByteArray();
+    const QFont font = painter->font();
+    const QPainter::RenderHints hints = painter->renderHints();
+    const QImage image = QGtkRenderServer::render(key, rect.size(), devicePixelRatio, [&](QPainter *p) {
+        p->setFont(font);
+        p->setRenderHints(hints);
+        p->translate(-rect.topLeft());
+        paint(p);
+    });
+    if (image.isNull())
+        return false;
+    painter->drawImage(rect.topLeft(), image);
+    return true;
+}
+
 /*!
     \class QGtkStyle
     \brief The QGtkStyle class provides a widget style rendered by GTK+
@@ -291,6 +357,7 @@ QGtkStyle::QGtkStyle()
     : QCommonStyle(*new QGtkStylePrivate)
 {
     Q_D(QGtkStyle);
+    QGtkStats::init();
     d->init();
 }
 
@@ -321,6 +388,13 @@ QPalette QGtkStyle::standardPalette() const
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        QPalette palette;
+        if (!QGtkRenderServer::call([&]() { palette = standardPalette(); }))
+            return QCommonStyle::standardPalette();
+        return palette;
+    }
+
     QPalette palette = QCommonStyle::standardPalette();
     if (d->isThemeAvailable()) {
         GtkStyle *style = d->gtkStyle();
@@ -432,8 +506,13 @@ void QGtkStyle::polish(QApplication *app)
         QApplication::setPalette(standardPalette());
         QApplicationPrivate::setSystemFont(d->getThemeFont());
         d->applyCustomPaletteHash();
-        if (!d->isKDE4Session())
+        if (!d->isKDE4Session()) {
             qApp->installEventFilter(&d->filter);
+            if (qEnvironmentVariableIsSet("QT6GTK2_PREWARM") && !d->prewarmer) {
+                d->prewarmer = new QGtkPrewarmer(this);
+                d->prewarmer->start();
+            }
+        }
     }
 }
 
@@ -445,7 +524,8 @@ void QGtkStyle::unpolish(QApplication *app)
     Q_D(QGtkStyle);
 
     QCommonStyle::unpolish(app);
-    QPixmapCache::clear();
+    QGtkPixmapCache::clear();
+    delete d->prewarmer;
 
     if (app->desktopSettingsAware() && d->isThemeAvailable() && !d->isKDE4Session())
         qApp->removeEventFilter(&d->filter);
@@ -495,19 +575,20 @@ int QGtkStyle::pixelMetric(PixelMetric metric,
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        int result = 0;
+        if (!QGtkRenderServer::call([&]() { result = pixelMetric(metric, option, widget); }))
+            return QCommonStyle::pixelMetric(metric, option, widget);
+        return result;
+    }
+
     if (!d->isThemeAvailable())
         return QCommonStyle::pixelMetric(metric, option, widget);
 
     switch (metric) {
     case PM_DefaultFrameWidth:
-        if (qobject_cast<const QFrame*>(widget)) {
-            if (GtkStyle *style =
-                gtk_rc_get_style_by_paths(gtk_settings_get_default(),
-                                                "*.GtkScrolledWindow",
-                                                "*.GtkScrolledWindow",
-                                                gtk_window_get_type()))
-                return qMax(style->xthickness, style->ythickness);
-        }
+        if (qobject_cast<const QFrame*>(widget))
+            return d->themePixelMetric(metric);
         return 2;
 
     case PM_MenuButtonIndicator:
@@ -525,53 +606,26 @@ int QGtkStyle::pixelMetric(PixelMetric metric,
     case PM_ToolBarItemSpacing:
         return 0;
 
-    case PM_ButtonShiftHorizontal: {
-        GtkWidget *gtkButton = d->gtkWidget("GtkButton");
-        guint horizontal_shift;
-        gtk_widget_style_get(gtkButton, "child-displacement-x", &horizontal_shift, nullptr);
-        return horizontal_shift;
-    }
-
-    case PM_ButtonShiftVertical: {
-        GtkWidget *gtkButton = d->gtkWidget("GtkButton");
-        guint vertical_shift;
-        gtk_widget_style_get(gtkButton, "child-displacement-y", &vertical_shift, nullptr);
-        return vertical_shift;
-    }
+    case PM_ButtonShiftHorizontal:
+    case PM_ButtonShiftVertical:
+    case PM_MenuPanelWidth:
+    case PM_ButtonIconSize:
+    case PM_SliderThickness:
+    case PM_SliderControlThickness:
+    case PM_ScrollBarExtent:
+    case PM_SliderLength:
+    case PM_ExclusiveIndicatorWidth:
+    case PM_ExclusiveIndicatorHeight:
+    case PM_IndicatorWidth:
+    case PM_IndicatorHeight:
+    case PM_MenuBarVMargin:
+    case PM_ScrollView_ScrollBarSpacing:
+    case PM_SubMenuOverlap:
+        return d->themePixelMetric(metric);
 
     case PM_MenuBarPanelWidth:
         return 0;
 
-    case PM_MenuPanelWidth: {
-        GtkWidget *gtkMenu = d->gtkWidget("GtkMenu");
-        guint horizontal_padding = 0;
-        // horizontal-padding is used by Maemo to get thicker borders
-        if (!gtk_check_version(2, 10, 0))
-            gtk_widget_style_get(gtkMenu, "horizontal-padding", &horizontal_padding, nullptr);
-        int padding = qMax<int>(gtk_widget_get_style(gtkMenu)->xthickness, horizontal_padding);
-        return padding;
-    }
-
-    case PM_ButtonIconSize: {
-        int retVal = 24;
-        GtkSettings *settings = gtk_settings_get_default();
-        gchararray icon_sizes;
-        g_object_get(settings, "gtk-icon-sizes", &icon_sizes, nullptr);
-        QStringList values = QString(QLS(icon_sizes)).split(QLatin1Char(':'));
-        g_free(icon_sizes);
-        QChar splitChar(QLatin1Char(','));
-        for (const QString &value : qAsConst(values)) {
-            if (value.startsWith(QLS("gtk-button="))) {
-                QString iconSize = value.right(value.size() - 11);
-
-                if (iconSize.contains(splitChar))
-                    retVal = iconSize.split(splitChar)[0].toInt();
-                break;
-            }
-        }
-        return retVal;
-    }
-
     case PM_MenuVMargin:
 
     case PM_MenuHMargin:
@@ -598,63 +652,9 @@ int QGtkStyle::pixelMetric(PixelMetric metric,
     case PM_SplitterWidth:
         return 6;
 
-    case PM_SliderThickness:
-    case PM_SliderControlThickness: {
-        GtkWidget *gtkScale = d->gtkWidget("GtkHScale");
-        gint val;
-        gtk_widget_style_get(gtkScale, "slider-width", &val, nullptr);
-        if (metric == PM_SliderControlThickness)
-            return val + 2*gtk_widget_get_style(gtkScale)->ythickness;
-        return val;
-    }
-
-    case PM_ScrollBarExtent: {
-        gint sliderLength;
-        gint trough_border;
-        GtkWidget *hScrollbar = d->gtkWidget("GtkHScrollbar");
-        gtk_widget_style_get(hScrollbar,
-                               "trough-border",   &trough_border,
-                               "slider-width",    &sliderLength,
-                               nullptr);
-        return sliderLength + trough_border*2;
-    }
-
     case PM_ScrollBarSliderMin:
         return 34;
 
-    case PM_SliderLength:
-        gint val;
-        gtk_widget_style_get(d->gtkWidget("GtkHScale"), "slider-length", &val, nullptr);
-        return val;
-
-    case PM_ExclusiveIndicatorWidth:
-    case PM_ExclusiveIndicatorHeight:
-    case PM_IndicatorWidth:
-    case PM_IndicatorHeight: {
-        GtkWidget *gtkCheckButton = d->gtkWidget("GtkCheckButton");
-        gint size, spacing;
-        gtk_widget_style_get(gtkCheckButton, "indicator-spacing", &spacing, "indicator-size", &size, nullptr);
-        return size + 2 * spacing;
-    }
-
-    case PM_MenuBarVMargin: {
-        GtkWidget *gtkMenubar = d->gtkWidget("GtkMenuBar");
-        return  qMax(0, gtk_widget_get_style(gtkMenubar)->ythickness);
-    }
-    case PM_ScrollView_ScrollBarSpacing:
-    {
-        gint spacing = 3;
-        GtkWidget *gtkScrollWindow = d->gtkWidget("GtkScrolledWindow");
-        Q_ASSERT(gtkScrollWindow);
-        gtk_widget_style_get(gtkScrollWindow, "scrollbar-spacing", &spacing, nullptr);
-        return spacing;
-    }
-    case PM_SubMenuOverlap: {
-        gint offset = 0;
-        GtkWidget *gtkMenu = d->gtkWidget("GtkMenu");
-        gtk_widget_style_get(gtkMenu, "horizontal-offset", &offset, nullptr);
-        return offset;
-    }
     case PM_ToolTipLabelFrameWidth:
         return 2;
     case PM_ButtonDefaultIndicator:
@@ -693,6 +693,13 @@ int QGtkStyle::styleHint(StyleHint hint, const QStyleOption *option, const QWidg
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        int result = 0;
+        if (!QGtkRenderServer::call([&]() { result = styleHint(hint, option, widget, returnData); }))
+            return QCommonStyle::styleHint(hint, option, widget, returnData);
+        return result;
+    }
+
     if (!d->isThemeAvailable())
         return QCommonStyle::styleHint(hint, option, widget, returnData);
 
@@ -745,91 +752,34 @@ int QGtkStyle::styleHint(StyleHint hint, const QStyleOption *option, const QWidg
 #endif
     case SH_ItemView_ArrowKeysNavigateIntoChildren:
         return false;
-    case SH_DialogButtonLayout: {
-        int ret = QDialogButtonBox::GnomeLayout;
-        gboolean alternateOrder = 0;
-        GtkSettings *settings = gtk_settings_get_default();
-        g_object_get(settings, "gtk-alternative-button-order", &alternateOrder, nullptr);
-
-        if (alternateOrder)
-            ret = QDialogButtonBox::WinLayout;
-
-        return ret;
-    }
-    break;
+    case SH_DialogButtonLayout:
+    case SH_ComboBox_Popup:
+    case SH_Menu_SubMenuPopupDelay:
+    case SH_DialogButtonBox_ButtonsHaveIcons:
+    case SH_UnderlineShortcut:
+        return d->themeStyleHint(hint);
 
     case SH_ToolButtonStyle:
-    {
         if (d->isKDE4Session())
             return QCommonStyle::styleHint(hint, option, widget, returnData);
-        GtkWidget *gtkToolbar = d->gtkWidget("GtkToolbar");
-        GtkToolbarStyle toolbar_style = GTK_TOOLBAR_ICONS;
-        g_object_get(gtkToolbar, "toolbar-style", &toolbar_style, nullptr);
-        switch (toolbar_style) {
-        case GTK_TOOLBAR_TEXT:
-            return Qt::ToolButtonTextOnly;
-        case GTK_TOOLBAR_BOTH:
-            return Qt::ToolButtonTextUnderIcon;
-        case GTK_TOOLBAR_BOTH_HORIZ:
-            return Qt::ToolButtonTextBesideIcon;
-        case GTK_TOOLBAR_ICONS:
-        default:
-            return Qt::ToolButtonIconOnly;
-        }
-    }
-    break;
+        return d->themeStyleHint(hint);
+
     case SH_SpinControls_DisableOnBounds:
         return int(true);
 
     case SH_DitherDisabledText:
         return int(false);
 
-    case SH_ComboBox_Popup: {
-        GtkWidget *gtkComboBox = d->gtkWidget("GtkComboBox");
-        gboolean appears_as_list;
-        gtk_widget_style_get((GtkWidget*)gtkComboBox, "appears-as-list", &appears_as_list, nullptr);
-        return appears_as_list ? 0 : 1;
-    }
-
     case SH_MenuBar_AltKeyNavigation:
         return int(false);
 
     case SH_EtchDisabledText:
         return int(false);
 
-    case SH_Menu_SubMenuPopupDelay: {
-        gint delay = 225;
-        GtkSettings *settings = gtk_settings_get_default();
-        g_object_get(settings, "gtk-menu-popup-delay", &delay, nullptr);
-        return delay;
-    }
-
-    case SH_ScrollView_FrameOnlyAroundContents: {
-        gboolean scrollbars_within_bevel = false;
+    case SH_ScrollView_FrameOnlyAroundContents:
         if (widget && widget->isWindow())
-            scrollbars_within_bevel = true;
-        else if (!gtk_check_version(2, 12, 0)) {
-            GtkWidget *gtkScrollWindow = d->gtkWidget("GtkScrolledWindow");
-            gtk_widget_style_get(gtkScrollWindow, "scrollbars-within-bevel", &scrollbars_within_bevel, nullptr);
-        }
-        return !scrollbars_within_bevel;
-    }
-
-    case SH_DialogButtonBox_ButtonsHaveIcons: {
-        gboolean buttonsHaveIcons = true;
-        GtkSettings *settings = gtk_settings_get_default();
-        g_object_get(settings, "gtk-button-images", &buttonsHaveIcons, nullptr);
-        return buttonsHaveIcons;
-    }
-
-    case SH_UnderlineShortcut: {
-        gboolean underlineShortcut = true;
-        if (!gtk_check_version(2, 12, 0)) {
-            GtkSettings *settings = gtk_settings_get_default();
-            g_object_get(settings, "gtk-enable-mnemonics", &underlineShortcut, nullptr);
-        }
-        return underlineShortcut;
-    }
+            return int(false);
+        return d->themeStyleHint(hint);
 
     default:
         break;
@@ -847,6 +797,15 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        if (!qt_gtk_draw_marshaled('P', element, !widget && qt_gtk_keep_primitive(element), option, painter,
+                                   [&](QPainter *p) { drawPrimitive(element, option, p, widget); }))
+            QCommonStyle::drawPrimitive(element, option, painter, widget);
+        return;
+    }
+
+    QGtkStatsScope statsScope(QGtkStats::Primitive, element);
+
     if (!d->isThemeAvailable()) {
         QCommonStyle::drawPrimitive(element, option, painter, widget);
         return;
@@ -868,13 +827,15 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
         // thin rectangular images
         const int pmSize = 64;
         const int border = proxy()->pixelMetric(PM_DefaultFrameWidth, option, widget);
-        const QString pmKey = QLatin1String("windowframe") % HexString<uint>(option->state);
+        QGtkPixmapKey pmKey = {};
+        pmKey.element = QGtkPixmapKey::WindowFrame;
+        pmKey.params[0] = int(option->state);
 
         QPixmap pixmap;
         QRect pmRect(QPoint(0,0), QSize(pmSize, pmSize));
 
         // Only draw through style once
-        if (!QPixmapCache::find(pmKey, &pixmap)) {
+        if (!QGtkPixmapCache::find(pmKey, &pixmap)) {
             pixmap = QPixmap(pmSize, pmSize);
             pixmap.fill(Qt::transparent);
             QPainter pmPainter(&pixmap);
@@ -893,7 +854,7 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
                 gtkPainter->paintShadow(d->gtkWidget("GtkFrame"), "viewport", pmRect,
                                         option->state & State_Enabled ? GTK_STATE_NORMAL : GTK_STATE_INSENSITIVE,
                                         shadow_type, style);
-            QPixmapCache::insert(pmKey, pixmap);
+            QGtkPixmapCache::insert(pmKey, pixmap);
             gtkPainter->reset(painter);
         }
 
@@ -949,11 +910,9 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
             painter->fillRect(option->rect, option->palette.window());
             break;
         }
-        GtkShadowType shadow_type;
         GtkWidget *gtkStatusbarFrame = d->gtkWidget("GtkStatusbar.GtkFrame");
-        gtk_widget_style_get(gtk_widget_get_parent(gtkStatusbarFrame), "shadow-type", &shadow_type, nullptr);
         gtkPainter->paintShadow(gtkStatusbarFrame, "frame", option->rect, GTK_STATE_NORMAL,
-                                shadow_type, gtk_widget_get_style(gtkStatusbarFrame));
+                                d->styleProperties("GtkStatusbar").shadowType, gtk_widget_get_style(gtkStatusbarFrame));
     }
     break;
 
@@ -1045,17 +1004,17 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
                 if (vopt && vopt->features & QStyleOptionViewItem::Alternate)
                     detail = "cell_odd_ruled";
                 bool isActive = option->state & State_Active;
-                QString key;
                 if (isActive ) {
                     // Required for active/non-active window appearance
-                    key = QLS("a");
                     QGtkStylePrivate::QGtkStylePrivate::gtkWidgetSetFocus(gtkTreeView, true);
                 }
                 bool isEnabled = (widget ? widget->isEnabled() : (vopt->state & QStyle::State_Enabled));
+                gtkPainter->setNinePatchStretch(Qt::Horizontal);
                 gtkPainter->paintFlatBox(gtkTreeView, detail, option->rect,
                                          option->state & State_Selected ? GTK_STATE_SELECTED :
                                          isEnabled ? GTK_STATE_NORMAL : GTK_STATE_INSENSITIVE,
-                                         GTK_SHADOW_OUT, gtk_widget_get_style(gtkTreeView), key);
+                                         GTK_SHADOW_OUT, gtk_widget_get_style(gtkTreeView), quint32(isActive));
+                gtkPainter->setNinePatchStretch(Qt::Orientations());
                 if (isActive )
                     QGtkStylePrivate::QGtkStylePrivate::gtkWidgetSetFocus(gtkTreeView, false);
             }
@@ -1085,8 +1044,7 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
 
     case PE_IndicatorToolBarHandle: {
         GtkWidget *gtkToolbar = d->gtkWidget("GtkToolbar");
-        GtkShadowType shadow_type;
-        gtk_widget_style_get(gtkToolbar, "shadow-type", &shadow_type, nullptr);
+        GtkShadowType shadow_type = d->styleProperties("GtkToolbar").shadowType;
         //Note when the toolbar is horizontal, the handle is vertical
         painter->setClipRect(option->rect);
         gtkPainter->paintHandle(gtkToolbar, "toolbar", option->rect.adjusted(-1, -1 ,0 ,1),
@@ -1137,7 +1095,7 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
         gtk_widget_modify_fg (gtkArrow, state, &color);
         gtkPainter->paintArrow(gtkArrow, "button", arrowRect,
                                type, state, shadow, false, gtk_widget_get_style(gtkArrow),
-                               QString::number(arrowColor.rgba(), 16));
+                               arrowColor.rgba());
         // Passing nullptr will revert the color change
         gtk_widget_modify_fg (gtkArrow, state, nullptr);
     }
@@ -1150,7 +1108,7 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
     case PE_PanelMenu: {
             GtkWidget *gtkMenu = d->gtkWidget("GtkMenu");
             gtkPainter->setAlphaSupport(false); // Note, alpha disabled for performance reasons
-            gtkPainter->paintBox(gtkMenu, "menu", option->rect, GTK_STATE_NORMAL, GTK_SHADOW_OUT, gtk_widget_get_style(gtkMenu), QString());
+            gtkPainter->paintBox(gtkMenu, "menu", option->rect, GTK_STATE_NORMAL, GTK_SHADOW_OUT, gtk_widget_get_style(gtkMenu));
         }
         break;
 
@@ -1172,12 +1130,10 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
         GtkWidget *gtkEntry = d->gtkWidget("GtkEntry");
 
 
-        gboolean interior_focus;
-        gint focus_line_width;
+        const QGtkStyleProperties entryProperties = d->styleProperties("GtkEntry");
+        const gboolean interior_focus = entryProperties.interiorFocus;
+        const gint focus_line_width = entryProperties.focusLineWidth;
         QRect rect = option->rect;
-        gtk_widget_style_get(gtkEntry,
-                               "interior-focus", &interior_focus,
-                               "focus-line-width", &focus_line_width, nullptr);
 
         // See https://bugzilla.mozilla.org/show_bug.cgi?id=405421 for info about this hack
         g_object_set_data(G_OBJECT(gtkEntry), "transparent-bg-hint", GINT_TO_POINTER(true));
@@ -1190,11 +1146,11 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
         gtkPainter->paintShadow(gtkEntry, "entry", rect, option->state & State_Enabled ?
                                 GTK_STATE_NORMAL : GTK_STATE_INSENSITIVE,
                                 GTK_SHADOW_IN, gtk_widget_get_style(gtkEntry),
-                                option->state & State_HasFocus ? QLS("focus") : QString());
+                                option->state & State_HasFocus ? 1 : 0);
         if (!interior_focus && option->state & State_HasFocus)
             gtkPainter->paintShadow(gtkEntry, "entry", option->rect, option->state & State_Enabled ?
                                     GTK_STATE_ACTIVE : GTK_STATE_INSENSITIVE,
-                                    GTK_SHADOW_IN, gtk_widget_get_style(gtkEntry), QLS("GtkEntryShadowIn"));
+                                    GTK_SHADOW_IN, gtk_widget_get_style(gtkEntry), 2);
 
         if (option->state & State_HasFocus)
             QGtkStylePrivate::gtkWidgetSetFocus(gtkEntry, false);
@@ -1270,33 +1226,30 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
         GtkStateType state = qt_gtk_state(option);
         if (option->state & State_On || option->state & State_Sunken)
             state = GTK_STATE_ACTIVE;
-        GtkWidget *gtkButton = isTool ? d->gtkWidget("GtkToolButton.GtkButton") : d->gtkWidget("GtkButton");
-        gint focusWidth, focusPad;
-        gboolean interiorFocus = false;
-        gtk_widget_style_get (gtkButton,
-                                "focus-line-width", &focusWidth,
-                                "focus-padding", &focusPad,
-                                "interior-focus", &interiorFocus, nullptr);
+        const QHashableLatin1Literal buttonPath = isTool ? QHashableLatin1Literal("GtkToolButton.GtkButton")
+                                                         : QHashableLatin1Literal("GtkButton");
+        GtkWidget *gtkButton = d->gtkWidget(buttonPath);
+        const QGtkStyleProperties buttonProperties = d->styleProperties(buttonPath);
+        const gint focusWidth = buttonProperties.focusLineWidth;
+        const gint focusPad = buttonProperties.focusPadding;
+        const gboolean interiorFocus = buttonProperties.interiorFocus;
 
         style = gtk_widget_get_style(gtkButton);
 
         QRect buttonRect = option->rect;
+        gtkPainter->setNinePatchStretch(Qt::Horizontal);
 
-        QString key;
         if (isDefault) {
-            key += QLS("def");
             gtk_widget_set_can_default(gtkButton, true);
             gtk_window_set_default((GtkWindow*)gtk_widget_get_toplevel(gtkButton), gtkButton);
             gtkPainter->paintBox(gtkButton, "buttondefault", buttonRect, state, GTK_SHADOW_IN,
-                                 style, isDefault ? QLS("d") : QString());
+                                 style);
         }
 
         bool hasFocus = option->state & State_HasFocus;
 
-        if (hasFocus) {
-            key += QLS("def");
+        if (hasFocus)
             QGtkStylePrivate::gtkWidgetSetFocus(gtkButton, true);
-        }
 
         if (!interiorFocus)
             buttonRect = buttonRect.adjusted(focusWidth, focusWidth, -focusWidth, -focusWidth);
@@ -1305,7 +1258,8 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
                                GTK_SHADOW_IN : GTK_SHADOW_OUT;
 
         gtkPainter->paintBox(gtkButton, "button", buttonRect, state, shadow,
-                             style, key);
+                             style, quint32(isDefault) | quint32(hasFocus) << 1);
+        gtkPainter->setNinePatchStretch(Qt::Orientations());
         if (isDefault)
             gtk_window_set_default((GtkWindow*)gtk_widget_get_toplevel(gtkButton), nullptr);
         if (hasFocus)
@@ -1328,20 +1282,18 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
             shadow = GTK_SHADOW_OUT;
 
         GtkWidget *gtkRadioButton = d->gtkWidget("GtkRadioButton");
-        gint spacing;
-        gtk_widget_style_get(gtkRadioButton, "indicator-spacing", &spacing, nullptr);
+        const gint spacing = d->styleProperties("GtkRadioButton").indicatorSpacing;
         QRect buttonRect = option->rect.adjusted(spacing, spacing, -spacing, -spacing);
         gtkPainter->setClipRect(option->rect);
         // ### Note: Ubuntulooks breaks when the proper widget is passed
         //           Murrine engine requires a widget not to get RGBA check - warnings
         GtkWidget *gtkCheckButton = d->gtkWidget("GtkCheckButton");
-        QString key(QLS("radiobutton"));
-        if (option->state & State_HasFocus) { // Themes such as Nodoka check this flag
-            key += QLatin1Char('f');
+        const bool hasFocus = option->state & State_HasFocus;
+        if (hasFocus) // Themes such as Nodoka check this flag
             QGtkStylePrivate::gtkWidgetSetFocus(gtkCheckButton, true);
-        }
-        gtkPainter->paintOption(gtkCheckButton , buttonRect, state, shadow, gtk_widget_get_style(gtkRadioButton), key);
-        if (option->state & State_HasFocus)
+        gtkPainter->paintOption(gtkCheckButton , buttonRect, state, shadow, gtk_widget_get_style(gtkRadioButton),
+                                hasFocus ? "radiobuttonf" : "radiobutton");
+        if (hasFocus)
             QGtkStylePrivate::gtkWidgetSetFocus(gtkCheckButton, false);
     }
     break;
@@ -1363,22 +1315,20 @@ void QGtkStyle::drawPrimitive(PrimitiveElement element,
         int spacing;
 
         GtkWidget *gtkCheckButton = d->gtkWidget("GtkCheckButton");
-        QString key(QLS("checkbutton"));
-        if (option->state & State_HasFocus) { // Themes such as Nodoka checks this flag
-            key += QLatin1Char('f');
+        const bool hasFocus = option->state & State_HasFocus;
+        if (hasFocus) // Themes such as Nodoka checks this flag
             QGtkStylePrivate::gtkWidgetSetFocus(gtkCheckButton, true);
-        }
 
         // Some styles such as aero-clone assume they can paint in the spacing area
         gtkPainter->setClipRect(option->rect);
 
-        gtk_widget_style_get(gtkCheckButton, "indicator-spacing", &spacing, nullptr);
+        spacing = d->styleProperties("GtkCheckButton").indicatorSpacing;
 
         QRect checkRect = option->rect.adjusted(spacing, spacing, -spacing, -spacing);
 
         gtkPainter->paintCheckbox(gtkCheckButton, checkRect, state, shadow, gtk_widget_get_style(gtkCheckButton),
-                                  key);
-        if (option->state & State_HasFocus)
+                                  hasFocus ? "checkbuttonf" : "checkbutton");
+        if (hasFocus)
             QGtkStylePrivate::gtkWidgetSetFocus(gtkCheckButton, false);
 
     }
@@ -1443,6 +1393,15 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        if (!qt_gtk_draw_marshaled('C', control, false, option, painter,
+                                   [&](QPainter *p) { drawComplexControl(control, option, p, widget); }))
+            QCommonStyle::drawComplexControl(control, option, painter, widget);
+        return;
+    }
+
+    QGtkStatsScope statsScope(QGtkStats::ComplexControl, control);
+
     if (!d->isThemeAvailable()) {
         QCommonStyle::drawComplexControl(control, option, painter, widget);
         return;
@@ -1809,7 +1768,38 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
         // and http://live.gnome.org/GnomeArt/Tutorials/GtkThemes/GtkComboBoxEntry
         if (const QStyleOptionComboBox *comboBox = qstyleoption_cast<const QStyleOptionComboBox *>(option)) {
             bool sunken = comboBox->state & State_On; // play dead, if combobox has no items
-            BEGIN_STYLE_PIXMAPCACHE(QString::fromLatin1("cb-%0-%1").arg(sunken).arg(comboBox->editable));
+            // Cached as a whole, keyed the same way as by BEGIN_STYLE_PIXMAPCACHE
+            // but without building a string for every paint
+            const qreal dpr = painter->device()->devicePixelRatio();
+            QGtkPixmapKey pmKey = {};
+            pmKey.element = QGtkPixmapKey::ComboBox;
+            pmKey.style = option->palette.cacheKey();
+            pmKey.width = qRound(option->rect.width() * dpr);
+            pmKey.height = qRound(option->rect.height() * dpr);
+            pmKey.params[0] = int(option->state);
+            pmKey.params[1] = int(comboBox->activeSubControls);
+            pmKey.params[2] = int(option->direction);
+            pmKey.extra = quint32(sunken) | quint32(comboBox->editable) << 1;
+
+            const int txType = painter->deviceTransform().type() | painter->worldTransform().type();
+            const bool doPixmapCache = !option->rect.isEmpty()
+                    && (txType <= QTransform::TxTranslate || painter->deviceTransform().type() == QTransform::TxScale);
+            QPixmap pixmap;
+            if (doPixmapCache && QGtkPixmapCache::find(pmKey, &pixmap)) {
+                painter->drawPixmap(option->rect.topLeft(), pixmap);
+                break;
+            }
+
+            QImage image;
+            QPainter imagePainter;
+            QPainter *p = painter;
+            if (doPixmapCache) {
+                image = QImage(QSize(pmKey.width, pmKey.height), QImage::Format_ARGB32_Premultiplied);
+                image.setDevicePixelRatio(dpr);
+                image.fill(0);
+                imagePainter.begin(&image);
+                p = &imagePainter;
+            }
             gtkPainter->reset(p);
             gtkPainter->setUsePixmapCache(false); // cached externally
 
@@ -1871,13 +1861,12 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                     else {
                         gtkPainter->paintFlatBox(gtkEntry, "entry_bg", contentRect,
                                                  option->state & State_Enabled ? GTK_STATE_NORMAL : GTK_STATE_INSENSITIVE,
-                                                 GTK_SHADOW_NONE, gtkEntryStyle, entryPath.toString() + QString::number(focus));
+                                                 GTK_SHADOW_NONE, gtkEntryStyle, quint32(focus) | quint32(comboBox->editable) << 1);
                     }
 
                     gtkPainter->paintShadow(gtkEntry, comboBox->editable ? "entry" : "frame", frameRect, frameState,
-                                            GTK_SHADOW_IN, gtkEntryStyle, entryPath.toString() +
-                                            QString::number(focus) + QString::number(comboBox->editable) +
-                                            QString::number(option->direction));
+                                            GTK_SHADOW_IN, gtkEntryStyle, quint32(focus) | quint32(comboBox->editable) << 1
+                                            | quint32(option->direction) << 2);
                     if (focus)
                         QGtkStylePrivate::gtkWidgetSetFocus(gtkEntry, false);
                 }
@@ -1893,8 +1882,8 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
 
                 Q_ASSERT(gtkToggleButton);
                 gtkPainter->paintBox(gtkToggleButton, "button", arrowButtonRect, buttonState,
-                                     shadow, gtk_widget_get_style(gtkToggleButton), buttonPath.toString() +
-                                     QString::number(focus) + QString::number(option->direction));
+                                     shadow, gtk_widget_get_style(gtkToggleButton), quint32(focus) | quint32(comboBox->editable) << 1
+                                     | quint32(option->direction) << 2);
                 if (focus)
                     QGtkStylePrivate::gtkWidgetSetFocus(gtkToggleButton, false);
             } else {
@@ -1907,7 +1896,7 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                 gtkPainter->paintBox(gtkToggleButton, "button",
                                      buttonRect, state,
                                      shadow, gtkToggleButtonStyle,
-                                     buttonPath.toString() + QString::number(focus));
+                                     quint32(focus) | quint32(comboBox->editable) << 1);
                 if (focus)
                     QGtkStylePrivate::gtkWidgetSetFocus(gtkToggleButton, false);
 
@@ -1924,11 +1913,10 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
 
                     gtkPainter->paintVline(gtkVSeparator, "vseparator",
                                            vLineRect, state, gtk_widget_get_style(gtkVSeparator),
-                                           0, vLineRect.height(), 0, vSeparatorPath.toString());
+                                           0, vLineRect.height(), 0, quint32(comboBox->editable));
 
 
-                    gint interiorFocus = true;
-                    gtk_widget_style_get(gtkToggleButton, "interior-focus", &interiorFocus, nullptr);
+                    const gboolean interiorFocus = d->styleProperties(buttonPath).interiorFocus;
                     int xt = interiorFocus ? gtkToggleButtonStyle->xthickness : 0;
                     int yt = interiorFocus ? gtkToggleButtonStyle->ythickness : 0;
                     if (focus && ((option->state & State_KeyboardFocusChange) || styleHint(SH_UnderlineShortcut, option, widget)))
@@ -1967,9 +1955,9 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                 gint minSize = 15;
                 QRect arrowWidgetRect;
 
-                if (gtkArrow && !gtk_check_version(2, 12, 0)) {
-                    gtk_widget_style_get(gtkArrow, "arrow-scaling", &scale, nullptr);
-                    gtk_widget_style_get(gtkCombo, "arrow-size", &minSize, nullptr);
+                if (gtkArrow) {
+                    scale = d->styleProperties(arrowPath).arrowScaling;
+                    minSize = d->styleProperties(comboBoxPath).arrowSize;
                 }
                 if (gtkArrow) {
                     GtkAllocation allocation;
@@ -1987,14 +1975,9 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                 arrowRect.moveCenter(arrowWidgetRect.center());
 
                 if (sunken) {
-                    int xoff, yoff;
-                    const QHashableLatin1Literal toggleButtonPath = comboBox->editable
-                            ? QHashableLatin1Literal("GtkComboBoxEntry.GtkToggleButton")
-                            : QHashableLatin1Literal("GtkComboBox.GtkToggleButton");
-
-                    GtkWidget *gtkButton = d->gtkWidget(toggleButtonPath);
-                    gtk_widget_style_get(gtkButton, "child-displacement-x", &xoff, nullptr);
-                    gtk_widget_style_get(gtkButton, "child-displacement-y", &yoff, nullptr);
+                    const QGtkStyleProperties toggleProperties = d->styleProperties(buttonPath);
+                    const int xoff = toggleProperties.childDisplacementX;
+                    const int yoff = toggleProperties.childDisplacementY;
                     arrowRect = arrowRect.adjusted(xoff, yoff, xoff, yoff);
                 }
 
@@ -2004,10 +1987,16 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                     gtkPainter->setClipRect(option->rect);
                     gtkPainter->paintArrow(gtkArrow, "arrow", arrowRect,
                                            GTK_ARROW_DOWN, state, GTK_SHADOW_NONE, true,
-                                           style, arrowPath.toString() + QString::number(option->direction));
+                                           style, quint32(comboBox->editable) | quint32(appears_as_list) << 1
+                                           | quint32(option->direction) << 2);
                 }
             }
-            END_STYLE_PIXMAPCACHE;
+            if (doPixmapCache) {
+                imagePainter.end();
+                pixmap = QPixmap::fromImage(image);
+                painter->drawPixmap(option->rect.topLeft(), pixmap);
+                QGtkPixmapCache::insert(pmKey, pixmap);
+            }
         }
         break;
 #endif // QT_NO_COMBOBOX
@@ -2112,19 +2101,12 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
             bool horizontal = scrollBar->orientation == Qt::Horizontal;
             GtkWidget * scrollbarWidget = horizontal ? gtkHScrollBar : gtkVScrollBar;
             style = gtk_widget_get_style(scrollbarWidget);
-            gboolean trough_under_steppers = true;
-            gboolean trough_side_details = false;
+            const QGtkStyleProperties scrollbarProperties =
+                    d->styleProperties(horizontal ? QHashableLatin1Literal("GtkHScrollbar")
+                                                 : QHashableLatin1Literal("GtkVScrollbar"));
+            const gboolean trough_under_steppers = scrollbarProperties.troughUnderSteppers;
             gboolean activate_slider = true;
-            gboolean stepper_size = 14;
-            gint trough_border = 1;
-            if (!gtk_check_version(2, 10, 0)) {
-                gtk_widget_style_get((GtkWidget*)(scrollbarWidget),
-                                           "trough-border",         &trough_border,
-                                           "trough-side-details",   &trough_side_details,
-                                           "trough-under-steppers", &trough_under_steppers,
-                                           /*"activate-slider",       &activate_slider,*/ //deprecated
-                                           "stepper-size",          &stepper_size, nullptr);
-            }
+            const gint trough_border = scrollbarProperties.troughBorder;
             if (trough_under_steppers) {
                 scrollBarAddLine.adjust(trough_border, trough_border, -trough_border, -trough_border);
                 scrollBarSubLine.adjust(trough_border, trough_border, -trough_border, -trough_border);
@@ -2166,7 +2148,9 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                 if (trough_under_steppers)
                     grooveRect = option->rect;
 
+                gtkPainter->setNinePatchStretch(horizontal ? Qt::Horizontal : Qt::Vertical);
                 gtkPainter->paintBox(scrollbarWidget, "trough", grooveRect, state, GTK_SHADOW_IN, style);
+                gtkPainter->setNinePatchStretch(Qt::Orientations());
             }
 
             //paint slider
@@ -2191,7 +2175,7 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                 }
 
                 gtkPainter->paintSlider(scrollbarWidget, "slider", scrollBarSlider, state, shadow, style,
-                                        horizontal ? GTK_ORIENTATION_HORIZONTAL : GTK_ORIENTATION_VERTICAL, QString(QLS("%0%1")).arg(fakePos).arg(maximum));
+                                        horizontal ? GTK_ORIENTATION_HORIZONTAL : GTK_ORIENTATION_VERTICAL, quint32(fakePos) | quint32(maximum) << 2);
             }
 
             if (scrollBar->subControls & SC_ScrollBarAddLine) {
@@ -2219,7 +2203,7 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
 
                 gtkPainter->paintBox(scrollbarWidget,
                                      horizontal ? "hscrollbar" : "vscrollbar", scrollBarAddLine,
-                                     state, shadow, style, QLS("add"));
+                                     state, shadow, style, 1);
 
                 gtkPainter->paintArrow(scrollbarWidget, horizontal ? "hscrollbar" : "vscrollbar", scrollBarAddLine.adjusted(4, 4, -4, -4),
                                        horizontal ? (reverse ? GTK_ARROW_LEFT : GTK_ARROW_RIGHT) :
@@ -2250,7 +2234,7 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                     state = GTK_STATE_PRELIGHT;
 
                 gtkPainter->paintBox(scrollbarWidget, horizontal ? "hscrollbar" : "vscrollbar", scrollBarSubLine,
-                                     state, shadow, style, QLS("sub"));
+                                     state, shadow, style, 2);
 
                 gtkPainter->paintArrow(scrollbarWidget, horizontal ? "hscrollbar" : "vscrollbar", scrollBarSubLine.adjusted(4, 4, -4, -4),
                                        horizontal ? (reverse ? GTK_ARROW_RIGHT : GTK_ARROW_LEFT) :
@@ -2317,12 +2301,9 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                 style = gtk_widget_get_style(gtkSpinButton);
 
 
-                QString key;
-
-                if (option->state & State_HasFocus) {
-                    key += QLatin1Char('f');
+                const quint32 key = option->state & State_HasFocus ? 1 : 0;
+                if (key)
                     QGtkStylePrivate::gtkWidgetSetFocus(gtkSpinButton, true);
-                }
 
                 quint64 resolve_mask = option->palette.resolveMask();
 
@@ -2438,6 +2419,9 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
             gtk_widget_set_direction(hScaleWidget, slider->upsideDown ?
                                                        GTK_TEXT_DIR_RTL : GTK_TEXT_DIR_LTR);
             GtkWidget *scaleWidget = horizontal ? hScaleWidget : vScaleWidget;
+            const QGtkStyleProperties scaleProperties =
+                    d->styleProperties(horizontal ? QHashableLatin1Literal("GtkHScale")
+                                                  : QHashableLatin1Literal("GtkVScale"));
             style = gtk_widget_get_style(scaleWidget);
 
             if ((option->subControls & SC_SliderGroove) && groove.isValid()) {
@@ -2462,23 +2446,20 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                     gtk_range_set_adjustment(range, adjustment);
                 }
 
-                int outerSize;
                 gtk_range_set_inverted(range, !horizontal);
-                gtk_widget_style_get(scaleWidget, "trough-border", &outerSize, nullptr);
-                outerSize++;
+                const int outerSize = scaleProperties.troughBorder + 1;
 
                 GtkStateType state = qt_gtk_state(option);
                 int focusFrameMargin = 2;
                 QRect grooveRect = option->rect.adjusted(focusFrameMargin, outerSize + focusFrameMargin,
                                    -focusFrameMargin, -outerSize - focusFrameMargin);
 
-                gboolean trough_side_details = false; // Indicates if the upper or lower scale background differs
-                if (!gtk_check_version(2, 10, 0))
-                    gtk_widget_style_get((GtkWidget*)(scaleWidget), "trough-side-details", &trough_side_details, nullptr);
+                // Indicates if the upper or lower scale background differs
+                const gboolean trough_side_details = scaleProperties.troughSideDetails;
 
                 if (!trough_side_details) {
                     gtkPainter->paintBox(scaleWidget, "trough", grooveRect, state,
-                                         GTK_SHADOW_IN, style, QString(QLS("p%0")).arg(slider->sliderPosition));
+                                         GTK_SHADOW_IN, style, quint32(slider->sliderPosition));
                 } else {
                     QRect upperGroove = grooveRect;
                     QRect lowerGroove = grooveRect;
@@ -2502,9 +2483,9 @@ void QGtkStyle::drawComplexControl(ComplexControl control, const QStyleOptionCom
                     }
 
                     gtkPainter->paintBox(scaleWidget, "trough-upper", upperGroove, state,
-                                         GTK_SHADOW_IN, style, QString(QLS("p%0")).arg(slider->sliderPosition));
+                                         GTK_SHADOW_IN, style, quint32(slider->sliderPosition));
                     gtkPainter->paintBox(scaleWidget, "trough-lower", lowerGroove, state,
-                                         GTK_SHADOW_IN, style, QString(QLS("p%0")).arg(slider->sliderPosition));
+                                         GTK_SHADOW_IN, style, quint32(slider->sliderPosition));
                 }
             }
 
@@ -2623,6 +2604,15 @@ void QGtkStyle::drawControl(ControlElement element,
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        if (!qt_gtk_draw_marshaled('E', element, false, option, painter,
+                                   [&](QPainter *p) { drawControl(element, option, p, widget); }))
+            QCommonStyle::drawControl(element, option, painter, widget);
+        return;
+    }
+
+    QGtkStatsScope statsScope(QGtkStats::Control, element);
+
     if (!d->isThemeAvailable()) {
         QCommonStyle::drawControl(element, option, painter, widget);
         return;
@@ -2914,7 +2904,9 @@ void QGtkStyle::drawControl(ControlElement element,
             if (option->state & State_Sunken)
                 shadow = GTK_SHADOW_IN;
 
+            gtkPainter->setNinePatchStretch(Qt::Horizontal);
             gtkPainter->paintBox(gtkTreeHeader, "button", option->rect.adjusted(-1, 0, 0, 0), state, shadow, gtk_widget_get_style(gtkTreeHeader));
+            gtkPainter->setNinePatchStretch(Qt::Orientations());
         }
 
         painter->restore();
@@ -2945,10 +2937,8 @@ void QGtkStyle::drawControl(ControlElement element,
             pixmap.fill(Qt::transparent);
             QPainter pmPainter(&pixmap);
             gtkPainter->reset(&pmPainter);
-            GtkShadowType shadow_type;
-            gtk_widget_style_get(gtkMenubar, "shadow-type", &shadow_type, nullptr);
             gtkPainter->paintBox(gtkMenubar, "menubar", menuBarRect,
-                                 GTK_STATE_NORMAL, shadow_type, gtk_widget_get_style(gtkMenubar));
+                                 GTK_STATE_NORMAL, d->styleProperties("GtkMenuBar").shadowType, gtk_widget_get_style(gtkMenubar));
             pmPainter.end();
             painter->drawPixmap(option->rect, pixmap, option->rect);
             gtkPainter->reset(painter);
@@ -2975,8 +2965,7 @@ void QGtkStyle::drawControl(ControlElement element,
                 pixmap.fill(Qt::transparent);
                 QPainter pmPainter(&pixmap);
                 gtkPainter->reset(&pmPainter);
-                GtkShadowType shadow_type;
-                gtk_widget_style_get(gtkMenubar, "shadow-type", &shadow_type, nullptr);
+                GtkShadowType shadow_type = d->styleProperties("GtkMenuBar").shadowType;
                 GdkColor gdkBg = gtk_widget_get_style(gtkMenubar)->bg[GTK_STATE_NORMAL]; // Theme can depend on transparency
                 painter->fillRect(option->rect, QColor(gdkBg.red>>8, gdkBg.green>>8, gdkBg.blue>>8));
                 gtkPainter->paintBox(gtkMenubar, "menubar", menuBarRect,
@@ -3000,8 +2989,7 @@ void QGtkStyle::drawControl(ControlElement element,
             QCommonStyle::drawControl(element, &item, painter, widget);
 
             if (act) {
-                GtkShadowType shadowType = GTK_SHADOW_NONE;
-                gtk_widget_style_get (gtkMenubarItem, "selected-shadow-type", &shadowType, nullptr);
+                GtkShadowType shadowType = d->styleProperties("GtkMenuBar.GtkMenuItem").selectedShadowType;
                 gtkPainter->paintBox(gtkMenubarItem, "menuitem", option->rect.adjusted(0, 0, 0, 3),
                                      GTK_STATE_PRELIGHT, shadowType, style);
                 //draw text
@@ -3039,8 +3027,7 @@ void QGtkStyle::drawControl(ControlElement element,
                 rect.adjust(0, 0, 1, 0);
 
             GtkWidget *gtkToolbar = d->gtkWidget("GtkToolbar");
-            GtkShadowType shadow_type = GTK_SHADOW_NONE;
-            gtk_widget_style_get(gtkToolbar, "shadow-type", &shadow_type, nullptr);
+            GtkShadowType shadow_type = d->styleProperties("GtkToolbar").shadowType;
             gtkPainter->paintBox(gtkToolbar, "toolbar", rect,
                                  GTK_STATE_NORMAL, shadow_type, gtk_widget_get_style(gtkToolbar));
         }
@@ -3064,17 +3051,10 @@ void QGtkStyle::drawControl(ControlElement element,
             if (menuItem->menuItemType == QStyleOptionMenuItem::Separator) {
                 GtkWidget *gtkMenuSeparator = d->gtkWidget("GtkMenu.GtkSeparatorMenuItem");
                 painter->setPen(shadow.lighter(106));
-                gboolean wide_separators = 0;
-                gint     separator_height = 0;
-                guint    horizontal_padding = 3;
+                const QGtkStyleProperties separatorProperties = d->styleProperties("GtkMenu.GtkSeparatorMenuItem");
+                const gboolean wide_separators = separatorProperties.wideSeparators;
+                const gint horizontal_padding = separatorProperties.horizontalPadding;
                 QRect separatorRect = option->rect;
-                if (!gtk_check_version(2, 10, 0)) {
-                    gtk_widget_style_get(gtkMenuSeparator,
-                                           "wide-separators",    &wide_separators,
-                                           "separator-height",   &separator_height,
-                                           "horizontal-padding", &horizontal_padding,
-                                           nullptr);
-                }
                 GtkStyle *gtkMenuSeparatorStyle = gtk_widget_get_style(gtkMenuSeparator);
                 separatorRect.setHeight(option->rect.height() - 2 * gtkMenuSeparatorStyle->ythickness);
                 separatorRect.setWidth(option->rect.width() - 2 * (horizontal_padding + gtkMenuSeparatorStyle->xthickness));
@@ -3098,7 +3078,9 @@ void QGtkStyle::drawControl(ControlElement element,
                 if (qobject_cast<const QComboBox*>(widget))
                     rect = option->rect;
 #endif
+                gtkPainter->setNinePatchStretch(Qt::Horizontal);
                 gtkPainter->paintBox(gtkMenuItem, "menuitem", rect, GTK_STATE_PRELIGHT, GTK_SHADOW_OUT, style);
+                gtkPainter->setNinePatchStretch(Qt::Orientations());
             }
 
             bool checkable = menuItem->checkType != QStyleOptionMenuItem::NotCheckable;
@@ -3106,8 +3088,7 @@ void QGtkStyle::drawControl(ControlElement element,
             bool enabled = menuItem->state & State_Enabled;
             bool ignoreCheckMark = false;
 
-            gint checkSize;
-            gtk_widget_style_get(d->gtkWidget("GtkMenu.GtkCheckMenuItem"), "indicator-size", &checkSize, nullptr);
+            const gint checkSize = d->styleProperties("GtkMenu.GtkCheckMenuItem").indicatorSize;
 
             int checkcol = qMax(menuItem->maxIconWidth, qMax(20, checkSize));
 
@@ -3139,7 +3120,7 @@ void QGtkStyle::drawControl(ControlElement element,
 
                         gtkPainter->setClipRect(checkRect.adjusted(-spacing, -spacing, spacing, spacing));
                         gtkPainter->paintOption(gtkMenuItem, checkRect.translated(-spacing, -spacing), state, shadow,
-                                                style, QLS("option"));
+                                                style, "option");
                         gtkPainter->setClipRect(QRect());
 
                     } else {
@@ -3155,7 +3136,7 @@ void QGtkStyle::drawControl(ControlElement element,
 
                             gtkPainter->setClipRect(checkRect.adjusted(-spacing, -spacing, -spacing, -spacing));
                             gtkPainter->paintCheckbox(gtkMenuItem, checkRect.translated(-spacing, -spacing), state, shadow,
-                                                      style, QLS("check"));
+                                                      style, "check");
                             gtkPainter->setClipRect(QRect());
                         }
                     }
@@ -3288,18 +3269,16 @@ void QGtkStyle::drawControl(ControlElement element,
 
                 QFontMetrics fm(menuitem->font);
                 int arrow_size = fm.ascent() + fm.descent() - 2 * style->ythickness;
-                gfloat arrow_scaling = 0.8;
+                const QGtkStyleProperties itemProperties =
+                        d->styleProperties(menuItem->checked ? QHashableLatin1Literal("GtkMenu.GtkCheckMenuItem")
+                                                             : QHashableLatin1Literal("GtkMenu.GtkMenuItem"));
+                const gfloat arrow_scaling = itemProperties.arrowScaling;
                 int extra = 0;
-                if (!gtk_check_version(2, 16, 0)) {
-                    // "arrow-scaling" is actually hardcoded and fails on hardy (see gtk+-2.12/gtkmenuitem.c)
-                    // though the current documentation states otherwise
-                    gtk_widget_style_get(gtkMenuItem, "arrow-scaling", &arrow_scaling, nullptr);
-                    // in versions < 2.16 ythickness was previously subtracted from the arrow_size
+                // in versions < 2.16 ythickness was previously subtracted from the arrow_size
+                if (!gtk_check_version(2, 16, 0))
                     extra = 2 * style->ythickness;
-                }
 
-                int horizontal_padding;
-                gtk_widget_style_get(gtkMenuItem, "horizontal-padding", &horizontal_padding, nullptr);
+                const int horizontal_padding = itemProperties.horizontalPadding;
 
                 const int dim = static_cast<int>(arrow_size * arrow_scaling) + extra;
                 int xpos = menuItem->rect.left() + menuItem->rect.width() - horizontal_padding - dim;
@@ -3321,8 +3300,7 @@ void QGtkStyle::drawControl(ControlElement element,
             proxy()->drawControl(CE_PushButtonBevel, btn, painter, widget);
             QStyleOptionButton subopt = *btn;
             subopt.rect = subElementRect(SE_PushButtonContents, btn, widget);
-            gint interiorFocus = true;
-            gtk_widget_style_get(gtkButton, "interior-focus", &interiorFocus, nullptr);
+            const gboolean interiorFocus = d->styleProperties("GtkButton").interiorFocus;
             GtkStyle *gtkButtonStyle = gtk_widget_get_style(gtkButton);
             int xt = interiorFocus ? gtkButtonStyle->xthickness : 0;
             int yt = interiorFocus ? gtkButtonStyle->ythickness : 0;
@@ -3413,7 +3391,9 @@ void QGtkStyle::drawControl(ControlElement element,
             Q_UNUSED(bar);
             GtkWidget *gtkProgressBar = d->gtkWidget("GtkProgressBar");
             GtkStateType state = qt_gtk_state(option);
+            gtkPainter->setNinePatchStretch(option->state & State_Horizontal ? Qt::Horizontal : Qt::Vertical);
             gtkPainter->paintBox(gtkProgressBar, "trough", option->rect, state, GTK_SHADOW_IN, gtk_widget_get_style(gtkProgressBar));
+            gtkPainter->setNinePatchStretch(Qt::Orientations());
         }
 
         break;
@@ -3423,7 +3403,9 @@ void QGtkStyle::drawControl(ControlElement element,
             GtkStateType state = option->state & State_Enabled ? GTK_STATE_NORMAL : GTK_STATE_INSENSITIVE;
             GtkWidget *gtkProgressBar = d->gtkWidget("GtkProgressBar");
             style = gtk_widget_get_style(gtkProgressBar);
+            gtkPainter->setNinePatchStretch(option->state & State_Horizontal ? Qt::Horizontal : Qt::Vertical);
             gtkPainter->paintBox(gtkProgressBar, "trough", option->rect, state, GTK_SHADOW_IN, style);
+            gtkPainter->setNinePatchStretch(Qt::Orientations());
             int xt = style->xthickness;
             int yt = style->ythickness;
             QRect rect = bar->rect.adjusted(xt, yt, -xt, -yt);
@@ -3494,12 +3476,14 @@ void QGtkStyle::drawControl(ControlElement element,
                 progressBar.setRect(rect.left() + step, rect.top(), slideWidth / 2, rect.height());
             }
 
-            QString key = QString(QLS("%0")).arg(fakePos);
+            const quint32 key = quint32(fakePos) | quint32(inverted) << 2;
             if (inverted) {
-                key += QLatin1String("inv");
                 gtkPainter->setFlipHorizontal(true);
             }
+            // The bar is always painted horizontally, vertical bars are rotated
+            gtkPainter->setNinePatchStretch(Qt::Horizontal);
             gtkPainter->paintBox(gtkProgressBar, "bar", progressBar, GTK_STATE_SELECTED, GTK_SHADOW_OUT, style, key);
+            gtkPainter->setNinePatchStretch(Qt::Orientations());
         }
 
         break;
@@ -3517,6 +3501,13 @@ QRect QGtkStyle::subControlRect(ComplexControl control, const QStyleOptionComple
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        QRect result;
+        if (!QGtkRenderServer::call([&]() { result = subControlRect(control, option, subControl, widget); }))
+            return QCommonStyle::subControlRect(control, option, subControl, widget);
+        return result;
+    }
+
     QRect rect = QCommonStyle::subControlRect(control, option, subControl, widget);
     if (!d->isThemeAvailable())
         return QCommonStyle::subControlRect(control, option, subControl, widget);
@@ -3840,6 +3831,13 @@ QSize QGtkStyle::sizeFromContents(ContentsType type, const QStyleOption *option,
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        QSize result;
+        if (!QGtkRenderServer::call([&]() { result = sizeFromContents(type, option, size, widget); }))
+            return QCommonStyle::sizeFromContents(type, option, size, widget);
+        return result;
+    }
+
     QSize newSize = QCommonStyle::sizeFromContents(type, option, size, widget);
     if (!d->isThemeAvailable())
         return newSize;
@@ -3890,18 +3888,17 @@ QSize QGtkStyle::sizeFromContents(ContentsType type, const QStyleOption *option,
                 newSize -= QSize(0, 2); // From cleanlooksstyle
             newSize += QSize(0, 1);
             GtkWidget *gtkButton = d->gtkWidget("GtkButton");
-            gint focusPadding, focusWidth;
-            gtk_widget_style_get(gtkButton, "focus-padding", &focusPadding, nullptr);
-            gtk_widget_style_get(gtkButton, "focus-line-width", &focusWidth, nullptr);
+            const QGtkStyleProperties buttonProperties = d->styleProperties("GtkButton");
+            const gint focusPadding = buttonProperties.focusPadding;
+            const gint focusWidth = buttonProperties.focusLineWidth;
             newSize = size;
             GtkStyle *gtkButtonStyle = gtk_widget_get_style(gtkButton);
             newSize += QSize(2*gtkButtonStyle->xthickness + 4, 2*gtkButtonStyle->ythickness);
             newSize += QSize(2*(focusWidth + focusPadding + 2), 2*(focusWidth + focusPadding));
 
-            GtkWidget *gtkButtonBox = d->gtkWidget("GtkHButtonBox");
-            gint minWidth = 85, minHeight = 0;
-            gtk_widget_style_get(gtkButtonBox, "child-min-width", &minWidth,
-                                   "child-min-height", &minHeight, nullptr);
+            const QGtkStyleProperties buttonBoxProperties = d->styleProperties("GtkHButtonBox");
+            const gint minWidth = buttonBoxProperties.childMinWidth;
+            const gint minHeight = buttonBoxProperties.childMinHeight;
             if (!btn->text.isEmpty() && newSize.width() < minWidth)
                 newSize.setWidth(minWidth);
             if (newSize.height() < minHeight)
@@ -4004,8 +4001,7 @@ QSize QGtkStyle::sizeFromContents(ContentsType type, const QStyleOption *option,
             newSize.setHeight(qMax(newSize.height() - 4, sizeReq.height));
             newSize += QSize(textMargin + style->xthickness - 1, 0);
 
-            gint checkSize;
-            gtk_widget_style_get(gtkMenuItem, "indicator-size", &checkSize, nullptr);
+            const gint checkSize = d->styleProperties("GtkMenu.GtkCheckMenuItem").indicatorSize;
             newSize.setWidth(newSize.width() + qMax(0, checkSize - 20));
         }
         break;
@@ -4023,6 +4019,13 @@ QPixmap QGtkStyle::standardPixmap(StandardPixmap sp, const QStyleOption *option,
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        QPixmap result;
+        if (!QGtkRenderServer::call([&]() { result = standardPixmap(sp, option, widget); }))
+            return QCommonStyle::standardPixmap(sp, option, widget);
+        return result;
+    }
+
     if (!d->isThemeAvailable())
         return QCommonStyle::standardPixmap(sp, option, widget);
 
@@ -4092,6 +4095,13 @@ QIcon QGtkStyle::standardIcon(StandardPixmap standardIcon,
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        QIcon result;
+        if (!QGtkRenderServer::call([&]() { result = QGtkStyle::standardIcon(standardIcon, option, widget); }))
+            return QCommonStyle::standardIcon(standardIcon, option, widget);
+        return result;
+    }
+
     if (!d->isThemeAvailable())
         return QCommonStyle::standardIcon(standardIcon, option, widget);
     switch (standardIcon) {
@@ -4136,6 +4146,13 @@ QRect QGtkStyle::subElementRect(SubElement element, const QStyleOption *option,
 {
     Q_D(const QGtkStyle);
 
+    if (!QGtkRenderServer::isGuiThread()) {
+        QRect result;
+        if (!QGtkRenderServer::call([&]() { result = subElementRect(element, option, widget); }))
+            return QCommonStyle::subElementRect(element, option, widget);
+        return result;
+    }
+
     QRect r = QCommonStyle::subElementRect(element, option, widget);
     if (!d->isThemeAvailable())
         return r;
@@ -4165,15 +4182,7 @@ QRect QGtkStyle::subElementRect(SubElement element, const QStyleOption *option,
         return option->rect;
     case SE_PushButtonContents:
         if (!gtk_check_version(2, 10, 0)) {
-            GtkWidget *gtkButton = d->gtkWidget("GtkButton");
-            GtkBorder *border = nullptr;
-            gtk_widget_style_get(gtkButton, "inner-border", &border, nullptr);
-            if (border) {
-                r = option->rect.adjusted(border->left, border->top, -border->right, -border->bottom);
-                gtk_border_free(border);
-            } else {
-                r = option->rect.adjusted(1, 1, -1, -1);
-            }
+            r = option->rect.marginsRemoved(d->styleProperties("GtkButton").innerBorder);
             r = visualRect(option->direction, option->rect, r);
         }
         break;
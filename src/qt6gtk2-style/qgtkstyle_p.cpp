@@ -32,6 +32,7 @@
 #include <qglobal.h>
 #if !defined(QT_NO_STYLE_GTK)
 
+#include <QDialogButtonBox>
 #include <QEvent>
 #include <QFile>
 #include <QStringList>
@@ -40,7 +41,14 @@
 #include <QUrl>
 #include <QDebug>
 
+#include <algorithm>
+
 #include "qgtk2painter_p.h"
+#include "qgtkdiskcache_p.h"
+#include "qgtkprewarmer_p.h"
+#include "qgtkrenderserver_p.h"
+#include "qgtksharedcache_p.h"
+#include "qgtkstats_p.h"
 #include <private/qapplication_p.h>
 #include <private/qiconloader_p.h>
 #include <qpa/qplatformfontdatabase.h>
@@ -48,7 +56,6 @@
 #include <QMenu>
 #include <QStyle>
 #include <QApplication>
-#include <QPixmapCache>
 #include <QStatusBar>
 #include <QMenuBar>
 #include <QToolBar>
@@ -86,20 +93,33 @@ Q_DECLARE_METATYPE(QGtkStylePrivate*)
 
 QT_BEGIN_NAMESPACE
 
+static void qt_gtk_reset_style_properties();
+
 static void gtkStyleSetCallback(GtkWidget*)
 {
     qRegisterMetaType<QGtkStylePrivate *>();
 
+    // The snapshot describes the old theme, read it again on next use
+    qt_gtk_reset_style_properties();
+
     // We have to let this function return and complete the event
     // loop to ensure that all gtk widgets have been styled before
     // updating
     QMetaObject::invokeMethod(styleScheduler(), "updateTheme", Qt::QueuedConnection);
 }
 
+// XSETTINGS changes, e.g. to gtk-icon-sizes or gtk-alternative-button-order,
+// are only announced as property notifications on GtkSettings
+static void gtkSettingsNotifyCallback(GObject *, GParamSpec *, gpointer)
+{
+    QGtkStylePrivate::clearThemeMetrics();
+}
+
 static void update_toolbar_style(GtkWidget *gtkToolBar, GParamSpec *, gpointer)
 {
     GtkToolbarStyle toolbar_style = GTK_TOOLBAR_ICONS;
     g_object_get(gtkToolBar, "toolbar-style", &toolbar_style, nullptr);
+    QGtkStylePrivate::clearThemeMetrics();
     QWidgetList widgets = QApplication::allWidgets();
     for (int i = 0; i < widgets.size(); ++i) {
         QWidget *widget = widgets.at(i);
@@ -138,12 +158,194 @@ bool QGtkStyleFilter::eventFilter(QObject *obj, QEvent *e)
         //if (!qt_app_palettes_hash() ||  qt_app_palettes_hash()->isEmpty()) {
         //    stylePrivate->applyCustomPaletteHash();
         //}
+    } else if (e->type() == QEvent::Show && obj->isWidgetType()) {
+        static const bool prerender = qEnvironmentVariableIsSet("QT6GTK2_PRERENDER");
+        QWidget *widget = static_cast<QWidget *>(obj);
+        if (prerender && widget->isWindow() && !widget->property("_q_gtk_prerendered").toBool()) {
+            widget->setProperty("_q_gtk_prerendered", true);
+            QGtkStylePrivate::prerender(widget);
+        }
+        if (widget->isWindow() && stylePrivate->prewarmer)
+            stylePrivate->prewarmer->start();
     }
     return QObject::eventFilter(obj, e);
 }
 
+// Widget paths looked up while painting. Each owns a slot in a flat array
+// that mirrors the widget map, so these lookups skip the QHash. The index
+// from hash buckets to slots is built at compile time.
+static constexpr QHashableLatin1Literal qt_gtk_known_paths[] = {
+    "GtkWindow",
+    "GtkArrow",
+    "GtkButton",
+    "GtkCheckButton",
+    "GtkRadioButton",
+    "GtkHButtonBox",
+    "GtkToolButton.GtkButton",
+    "GtkEntry",
+    "GtkFrame",
+    "GtkSpinButton",
+    "GtkHScale",
+    "GtkVScale",
+    "GtkHScrollbar",
+    "GtkVScrollbar",
+    "GtkScrolledWindow",
+    "GtkProgressBar",
+    "GtkNotebook",
+    "GtkStatusbar",
+    "GtkStatusbar.GtkFrame",
+    "GtkTreeView",
+    "GtkTreeView.GtkButton",
+    "GtkToolbar",
+    "GtkToolbar.GtkSeparatorToolItem",
+    "GtkMenu",
+    "GtkMenu.GtkMenuItem",
+    "GtkMenu.GtkCheckMenuItem",
+    "GtkMenu.GtkSeparatorMenuItem",
+    "GtkMenuBar",
+    "GtkMenuBar.GtkMenuItem",
+    "GtkComboBox",
+    "GtkComboBox.GtkFrame",
+    "GtkComboBox.GtkToggleButton",
+    "GtkComboBox.GtkToggleButton.GtkArrow",
+    "GtkComboBox.GtkToggleButton.GtkHBox.GtkArrow",
+    "GtkComboBox.GtkToggleButton.GtkHBox.GtkVSeparator",
+    "GtkComboBoxEntry",
+    "GtkComboBoxEntry.GtkEntry",
+    "GtkComboBoxEntry.GtkToggleButton",
+    "GtkComboBoxEntry.GtkToggleButton.GtkArrow",
+    "GtkComboBoxEntry.GtkToggleButton.GtkHBox.GtkArrow",
+    "GtkComboBoxEntry.GtkToggleButton.GtkHBox.GtkVSeparator"
+};
+
+enum {
+    knownPathCount = sizeof(qt_gtk_known_paths) / sizeof(qt_gtk_known_paths[0]),
+    knownPathBuckets = 128
+};
+Q_STATIC_ASSERT(knownPathCount < knownPathBuckets / 2);
+
+struct QGtkKnownPathIndex
+{
+    qint8 slots[knownPathBuckets];
+};
+
+// Open addressing with linear probing, -1 marks an empty bucket
+static constexpr QGtkKnownPathIndex qt_gtk_build_known_path_index()
+{
+    QGtkKnownPathIndex index = {};
+    for (int i = 0; i < knownPathBuckets; ++i)
+        index.slots[i] = -1;
+    for (int i = 0; i < knownPathCount; ++i) {
+        uint bucket = qt_gtk_known_paths[i].hash() % knownPathBuckets;
+        while (index.slots[bucket] >= 0)
+            bucket = (bucket + 1) % knownPathBuckets;
+        index.slots[bucket] = qint8(i);
+    }
+    return index;
+}
+
+static constexpr QGtkKnownPathIndex qt_gtk_known_path_index = qt_gtk_build_known_path_index();
+static GtkWidget *qt_gtk_known_widgets[knownPathCount];
+static QGtkStyleProperties qt_gtk_known_properties[knownPathCount];
+
+static void qt_gtk_reset_style_properties()
+{
+    std::fill(std::begin(qt_gtk_known_properties), std::end(qt_gtk_known_properties),
+              QGtkStyleProperties());
+}
+
+// Returns the slot of a well-known path, -1 for any other path
+static int qt_gtk_known_slot(const QHashableLatin1Literal &path)
+{
+    uint bucket = path.hash() % knownPathBuckets;
+    for (int slot = qt_gtk_known_path_index.slots[bucket]; slot >= 0;
+         slot = qt_gtk_known_path_index.slots[bucket]) {
+        if (qt_gtk_known_paths[slot] == path)
+            return slot;
+        bucket = (bucket + 1) % knownPathBuckets;
+    }
+    return -1;
+}
+
+// Apart from the window and the button, the proxy widgets are created on
+// the first lookup of a path below them. Realizing a widget costs X round
+// trips and most applications only draw a few kinds of widgets.
+enum QGtkProxyWidget {
+    ToolButtonProxy,
+    ArrowProxy,
+    HButtonBoxProxy,
+    CheckButtonProxy,
+    RadioButtonProxy,
+    ComboBoxProxy,
+    ComboBoxEntryProxy,
+    EntryProxy,
+    FrameProxy,
+    ExpanderProxy,
+    StatusbarProxy,
+    HScaleProxy,
+    HScrollbarProxy,
+    ScrolledWindowProxy,
+    MenuProxy,
+    NotebookProxy,
+    ProgressBarProxy,
+    SpinButtonProxy,
+    ToolbarProxy,
+    TreeViewProxy,
+    VScaleProxy,
+    VScrollbarProxy,
+    ProxyWidgetCount
+};
+
+// Maps the class at the root of a widget path to the proxy creating it
+static const struct {
+    const char *root;
+    QGtkProxyWidget proxy;
+} qt_gtk_proxy_roots[] = {
+    { "GtkToolButton", ToolButtonProxy },
+    { "GtkArrow", ArrowProxy },
+    { "GtkHButtonBox", HButtonBoxProxy },
+    { "GtkCheckButton", CheckButtonProxy },
+    { "GtkRadioButton", RadioButtonProxy },
+    { "GtkComboBox", ComboBoxProxy },
+    { "GtkComboBoxEntry", ComboBoxEntryProxy },
+    { "GtkEntry", EntryProxy },
+    { "GtkFrame", FrameProxy },
+    { "GtkExpander", ExpanderProxy },
+    { "GtkStatusbar", StatusbarProxy },
+    { "GtkHScale", HScaleProxy },
+    { "GtkHScrollbar", HScrollbarProxy },
+    { "GtkScrolledWindow", ScrolledWindowProxy },
+    { "GtkMenuBar", MenuProxy },
+    { "GtkMenu", MenuProxy },
+    { "GtkNotebook", NotebookProxy },
+    { "GtkProgressBar", ProgressBarProxy },
+    { "GtkSpinButton", SpinButtonProxy },
+    { "GtkToolbar", ToolbarProxy },
+    { "GtkTreeView", TreeViewProxy },
+    { "GtkVScale", VScaleProxy },
+    { "GtkVScrollbar", VScrollbarProxy }
+};
+
+static bool qt_gtk_proxy_created[ProxyWidgetCount];
+
+// Returns the proxy that creates the widget at path, -1 if there is none
+static int qt_gtk_proxy_for(const QHashableLatin1Literal &path)
+{
+    const char *dot = static_cast<const char *>(memchr(path.data(), '.', path.size()));
+    const int rootSize = dot ? int(dot - path.data()) : path.size();
+    for (const auto &root : qt_gtk_proxy_roots) {
+        if (int(qstrlen(root.root)) == rootSize && !strncmp(root.root, path.data(), rootSize))
+            return root.proxy;
+    }
+    return -1;
+}
+
 QList<QGtkStylePrivate *> QGtkStylePrivate::instances;
 QGtkStylePrivate::WidgetMap *QGtkStylePrivate::widgetMap = nullptr;
+QHash<GtkWidget *, quint32> QGtkStylePrivate::widgetClassIds;
+QHash<GType, quint32> QGtkStylePrivate::widgetTypeIds;
+QHash<int, int> QGtkStylePrivate::themeMetrics;
+QHash<int, int> QGtkStylePrivate::themeHints;
 
 QGtkStylePrivate::QGtkStylePrivate()
   : QCommonStylePrivate()
@@ -163,6 +365,18 @@ void QGtkStylePrivate::init()
     initGtkWidgets();
 }
 
+// Paints a window offscreen in batch mode, so that all the theme elements
+// it needs are rendered together and already cached once it gets exposed
+void QGtkStylePrivate::prerender(QWidget *window)
+{
+    QImage scratch(window->size(), QImage::Format_ARGB32_Premultiplied);
+    if (scratch.isNull())
+        return;
+    gtkPainter()->beginBatch();
+    window->render(&scratch, QPoint(), QRegion(), QWidget::DrawChildren);
+    gtkPainter()->endBatch();
+}
+
 QGtkPainter* QGtkStylePrivate::gtkPainter(QPainter *painter)
 {
     // TODO: choose between gtk2 and gtk3
@@ -173,9 +387,15 @@ QGtkPainter* QGtkStylePrivate::gtkPainter(QPainter *painter)
 
 GtkWidget* QGtkStylePrivate::gtkWidget(const QHashableLatin1Literal &path)
 {
+    const int slot = qt_gtk_known_slot(path);
+    if (slot >= 0) {
+        if (!qt_gtk_known_widgets[slot])
+            createProxyWidget(qt_gtk_proxy_for(path));
+        return qt_gtk_known_widgets[slot];
+    }
     GtkWidget *widget = gtkWidgetMap()->value(path);
     if (!widget) {
-        // Theme might have rearranged widget internals
+        createProxyWidget(qt_gtk_proxy_for(path));
         widget = gtkWidgetMap()->value(path);
     }
     return widget;
@@ -183,11 +403,116 @@ GtkWidget* QGtkStylePrivate::gtkWidget(const QHashableLatin1Literal &path)
 
 GtkStyle* QGtkStylePrivate::gtkStyle(const QHashableLatin1Literal &path)
 {
-    if (GtkWidget *w = gtkWidgetMap()->value(path))
+    if (GtkWidget *w = gtkWidget(path))
         return gtk_widget_get_style(w);
     return nullptr;
 }
 
+/*! \internal
+ * Returns the style properties of the widget at \a path. Well-known paths
+ * keep a snapshot until the theme changes, other paths are read each time.
+ * The result is a copy, so nested calls for other paths cannot change it.
+ */
+QGtkStyleProperties QGtkStylePrivate::styleProperties(const QHashableLatin1Literal &path)
+{
+    const int slot = qt_gtk_known_slot(path);
+    if (slot >= 0) {
+        QGtkStyleProperties &properties = qt_gtk_known_properties[slot];
+        if (!properties.loaded) {
+            if (GtkWidget *widget = gtkWidget(path))
+                properties.load(widget);
+        }
+        return properties;
+    }
+    QGtkStyleProperties uncached;
+    if (GtkWidget *widget = gtkWidget(path))
+        uncached.load(widget);
+    return uncached;
+}
+
+void QGtkStyleProperties::load(GtkWidget *widget)
+{
+    gtk_widget_style_get(widget,
+                         "interior-focus",   &interiorFocus,
+                         "focus-line-width", &focusLineWidth,
+                         "focus-padding",    &focusPadding, nullptr);
+    if (!gtk_check_version(2, 10, 0)) {
+        gtk_widget_style_get(widget,
+                             "wide-separators",  &wideSeparators,
+                             "separator-height", &separatorHeight, nullptr);
+    }
+
+    if (GTK_IS_BUTTON(widget)) {
+        gtk_widget_style_get(widget,
+                             "child-displacement-x", &childDisplacementX,
+                             "child-displacement-y", &childDisplacementY, nullptr);
+        if (!gtk_check_version(2, 10, 0)) {
+            GtkBorder *border = nullptr;
+            gtk_widget_style_get(widget, "inner-border", &border, nullptr);
+            if (border) {
+                innerBorder = QMargins(border->left, border->top, border->right, border->bottom);
+                gtk_border_free(border);
+            }
+        }
+    }
+    if (GTK_IS_CHECK_BUTTON(widget)) {
+        gtk_widget_style_get(widget,
+                             "indicator-size",    &indicatorSize,
+                             "indicator-spacing", &indicatorSpacing, nullptr);
+    }
+    if (GTK_IS_RANGE(widget)) {
+        gtk_widget_style_get(widget,
+                             "slider-width",  &sliderWidth,
+                             "trough-border", &troughBorder,
+                             "stepper-size",  &stepperSize, nullptr);
+        if (!gtk_check_version(2, 10, 0)) {
+            gtk_widget_style_get(widget,
+                                 "trough-side-details",   &troughSideDetails,
+                                 "trough-under-steppers", &troughUnderSteppers, nullptr);
+        }
+    }
+    if (GTK_IS_SCALE(widget))
+        gtk_widget_style_get(widget, "slider-length", &sliderLength, nullptr);
+    if (GTK_IS_MENU(widget)) {
+        gtk_widget_style_get(widget, "horizontal-offset", &horizontalOffset, nullptr);
+        // horizontal-padding is used by Maemo to get thicker borders
+        if (!gtk_check_version(2, 10, 0))
+            gtk_widget_style_get(widget, "horizontal-padding", &horizontalPadding, nullptr);
+    }
+    if (GTK_IS_MENU_ITEM(widget)) {
+        gtk_widget_style_get(widget,
+                             "horizontal-padding",   &horizontalPadding,
+                             "selected-shadow-type", &selectedShadowType, nullptr);
+        arrowScaling = 0.8f;
+        // "arrow-scaling" is actually hardcoded and fails on hardy (see gtk+-2.12/gtkmenuitem.c)
+        // though the current documentation states otherwise
+        if (!gtk_check_version(2, 16, 0))
+            gtk_widget_style_get(widget, "arrow-scaling", &arrowScaling, nullptr);
+    }
+    if (GTK_IS_CHECK_MENU_ITEM(widget))
+        gtk_widget_style_get(widget, "indicator-size", &indicatorSize, nullptr);
+    if (GTK_IS_ARROW(widget) && !gtk_check_version(2, 12, 0))
+        gtk_widget_style_get(widget, "arrow-scaling", &arrowScaling, nullptr);
+    if (GTK_IS_COMBO_BOX(widget)) {
+        gtk_widget_style_get(widget, "appears-as-list", &appearsAsList, nullptr);
+        if (!gtk_check_version(2, 12, 0))
+            gtk_widget_style_get(widget, "arrow-size", &arrowSize, nullptr);
+    }
+    if (GTK_IS_SCROLLED_WINDOW(widget)) {
+        gtk_widget_style_get(widget, "scrollbar-spacing", &scrollbarSpacing, nullptr);
+        if (!gtk_check_version(2, 12, 0))
+            gtk_widget_style_get(widget, "scrollbars-within-bevel", &scrollbarsWithinBevel, nullptr);
+    }
+    if (GTK_IS_STATUSBAR(widget) || GTK_IS_TOOLBAR(widget) || GTK_IS_MENU_BAR(widget))
+        gtk_widget_style_get(widget, "shadow-type", &shadowType, nullptr);
+    if (GTK_IS_BUTTON_BOX(widget)) {
+        gtk_widget_style_get(widget,
+                             "child-min-width",  &childMinWidth,
+                             "child-min-height", &childMinHeight, nullptr);
+    }
+    loaded = true;
+}
+
 void QGtkStylePrivate::gtkWidgetSetFocus(GtkWidget *widget, bool focus)
 {
     GdkEvent *event = gdk_event_new(GDK_FOCUS_CHANGE);
@@ -276,7 +601,7 @@ void QGtkStylePrivate::initGtkWidgets() const
     gtk_widget_realize(gtkWindow);
     QHashableLatin1Literal widgetPath = QHashableLatin1Literal::fromData(strdup("GtkWindow"));
     removeWidgetFromMap(widgetPath);
-    gtkWidgetMap()->insert(widgetPath, gtkWindow);
+    insertWidget(widgetPath, gtkWindow);
 
 
     // Make all other widgets. respect the text direction
@@ -287,42 +612,17 @@ void QGtkStylePrivate::initGtkWidgets() const
         GtkWidget *gtkButton = gtk_button_new();
         addWidget(gtkButton);
         g_signal_connect(gtkButton, "style-set", G_CALLBACK(gtkStyleSetCallback), 0);
-        addWidget((GtkWidget*)gtk_tool_button_new(nullptr, "Qt"));
-        addWidget(gtk_arrow_new(GTK_ARROW_DOWN, GTK_SHADOW_NONE));
-        addWidget(gtk_hbutton_box_new());
-        addWidget(gtk_check_button_new());
-        addWidget(gtk_radio_button_new(nullptr));
-        addWidget(gtk_combo_box_new());
-        addWidget(gtk_combo_box_entry_new());
-        GtkWidget *entry = gtk_entry_new();
-        // gtk-im-context-none is supported in gtk+ since 2.19.5
-        // and also exists in gtk3
-        // http://git.gnome.org/browse/gtk+/tree/gtk/gtkimmulticontext.c?id=2.19.5#n33
-        // reason that we don't use gtk-im-context-simple here is,
-        // gtk-im-context-none has less overhead, and 2.19.5 is
-        // relatively old. and even for older gtk+, it will fallback
-        // to gtk-im-context-simple if gtk-im-context-none doesn't
-        // exists.
-        g_object_set(entry, "im-module", "gtk-im-context-none", nullptr);
-        addWidget(entry);
-        addWidget(gtk_frame_new(nullptr));
-        addWidget(gtk_expander_new(""));
-        addWidget(gtk_statusbar_new());
-        addWidget(gtk_hscale_new((GtkAdjustment*)gtk_adjustment_new(1, 0, 1, 0, 0, 0)));
-        addWidget(gtk_hscrollbar_new(nullptr));
-        addWidget(gtk_scrolled_window_new(nullptr, nullptr));
-
-        initGtkMenu();
-        addWidget(gtk_notebook_new());
-        addWidget(gtk_progress_bar_new());
-        addWidget(gtk_spin_button_new((GtkAdjustment*)gtk_adjustment_new(1, 0, 1, 0, 0, 0), 0.1, 3));
-        GtkWidget *toolbar = gtk_toolbar_new();
-        g_signal_connect (toolbar, "notify::toolbar-style", G_CALLBACK (update_toolbar_style), toolbar);
-        gtk_toolbar_insert((GtkToolbar*)toolbar, gtk_separator_tool_item_new(), -1);
-        addWidget(toolbar);
-        initGtkTreeview();
-        addWidget(gtk_vscale_new((GtkAdjustment*)gtk_adjustment_new(1, 0, 1, 0, 0, 0)));
-        addWidget(gtk_vscrollbar_new(nullptr));
+        static bool settingsConnected = false;
+        if (!settingsConnected) {
+            g_signal_connect(gtk_settings_get_default(), "notify", G_CALLBACK(gtkSettingsNotifyCallback), nullptr);
+            settingsConnected = true;
+        }
+        // The other proxies are created on demand, all of them up front
+        // with QT6GTK2_EAGER_WIDGETS to compare the startup time
+        if (qEnvironmentVariableIsSet("QT6GTK2_EAGER_WIDGETS")) {
+            for (int proxy = 0; proxy < ProxyWidgetCount; ++proxy)
+                createProxyWidget(proxy);
+        }
     }
     else // Rebuild map
     {
@@ -331,6 +631,8 @@ void QGtkStylePrivate::initGtkWidgets() const
         // to reflect this;
         QHash<QHashableLatin1Literal, GtkWidget*> oldMap = *gtkWidgetMap();
         gtkWidgetMap()->clear();
+        std::fill(std::begin(qt_gtk_known_widgets), std::end(qt_gtk_known_widgets), nullptr);
+        qt_gtk_reset_style_properties();
         QHashIterator<QHashableLatin1Literal, GtkWidget*> it(oldMap);
         while (it.hasNext()) {
             it.next();
@@ -354,6 +656,10 @@ void QGtkStylePrivate::cleanupGtkWidgets()
     for (QHash<QHashableLatin1Literal, GtkWidget *>::const_iterator it = widgetMap->constBegin();
          it != widgetMap->constEnd(); ++it)
         free(const_cast<char *>(it.key().data()));
+    std::fill(std::begin(qt_gtk_known_widgets), std::end(qt_gtk_known_widgets), nullptr);
+    std::fill(std::begin(qt_gtk_proxy_created), std::end(qt_gtk_proxy_created), false);
+    qt_gtk_reset_style_properties();
+    widgetClassIds.clear();
 }
 
 QString QGtkStylePrivate::getThemeName()
@@ -414,6 +720,115 @@ GtkWidget* QGtkStylePrivate::getTextColorWidget() const
     return  gtkWidget("GtkEntry");
 }
 
+/* \internal
+ * Creates the gtk widget of proxy along with its subwidgets, unless that
+ * happened already or gtk is not initialized.
+ */
+void QGtkStylePrivate::createProxyWidget(int proxy)
+{
+    if (proxy < 0 || qt_gtk_proxy_created[proxy] || !widgetMap || !widgetMap->contains("GtkWindow"))
+        return;
+    qt_gtk_proxy_created[proxy] = true;
+
+    QElapsedTimer timer;
+    timer.start();
+    switch (proxy) {
+    case ToolButtonProxy:
+        addWidget((GtkWidget*)gtk_tool_button_new(nullptr, "Qt"));
+        break;
+    case ArrowProxy:
+        addWidget(gtk_arrow_new(GTK_ARROW_DOWN, GTK_SHADOW_NONE));
+        break;
+    case HButtonBoxProxy:
+        addWidget(gtk_hbutton_box_new());
+        break;
+    case CheckButtonProxy:
+        addWidget(gtk_check_button_new());
+        break;
+    case RadioButtonProxy:
+        addWidget(gtk_radio_button_new(nullptr));
+        break;
+    case ComboBoxProxy:
+        addWidget(gtk_combo_box_new());
+        break;
+    case ComboBoxEntryProxy:
+        addWidget(gtk_combo_box_entry_new());
+        break;
+    case EntryProxy: {
+        GtkWidget *entry = gtk_entry_new();
+        // gtk-im-context-none is supported in gtk+ since 2.19.5
+        // and also exists in gtk3
+        // http://git.gnome.org/browse/gtk+/tree/gtk/gtkimmulticontext.c?id=2.19.5#n33
+        // reason that we don't use gtk-im-context-simple here is,
+        // gtk-im-context-none has less overhead, and 2.19.5 is
+        // relatively old. and even for older gtk+, it will fallback
+        // to gtk-im-context-simple if gtk-im-context-none doesn't
+        // exists.
+        g_object_set(entry, "im-module", "gtk-im-context-none", nullptr);
+        addWidget(entry);
+        break;
+    }
+    case FrameProxy:
+        addWidget(gtk_frame_new(nullptr));
+        break;
+    case ExpanderProxy:
+        addWidget(gtk_expander_new(""));
+        break;
+    case StatusbarProxy:
+        addWidget(gtk_statusbar_new());
+        break;
+    case HScaleProxy:
+        addWidget(gtk_hscale_new((GtkAdjustment*)gtk_adjustment_new(1, 0, 1, 0, 0, 0)));
+        break;
+    case HScrollbarProxy:
+        addWidget(gtk_hscrollbar_new(nullptr));
+        break;
+    case ScrolledWindowProxy:
+        addWidget(gtk_scrolled_window_new(nullptr, nullptr));
+        break;
+    case MenuProxy:
+        if (!instances.isEmpty())
+            instances.last()->initGtkMenu();
+        break;
+    case NotebookProxy:
+        addWidget(gtk_notebook_new());
+        break;
+    case ProgressBarProxy:
+        addWidget(gtk_progress_bar_new());
+        break;
+    case SpinButtonProxy:
+        addWidget(gtk_spin_button_new((GtkAdjustment*)gtk_adjustment_new(1, 0, 1, 0, 0, 0), 0.1, 3));
+        break;
+    case ToolbarProxy: {
+        GtkWidget *toolbar = gtk_toolbar_new();
+        g_signal_connect (toolbar, "notify::toolbar-style", G_CALLBACK (update_toolbar_style), toolbar);
+        gtk_toolbar_insert((GtkToolbar*)toolbar, gtk_separator_tool_item_new(), -1);
+        addWidget(toolbar);
+        break;
+    }
+    case TreeViewProxy:
+        if (!instances.isEmpty())
+            instances.last()->initGtkTreeview();
+        break;
+    case VScaleProxy:
+        addWidget(gtk_vscale_new((GtkAdjustment*)gtk_adjustment_new(1, 0, 1, 0, 0, 0)));
+        break;
+    case VScrollbarProxy:
+        addWidget(gtk_vscrollbar_new(nullptr));
+        break;
+    default:
+        break;
+    }
+    if (QGtkStats::isEnabled()) {
+        for (const auto &root : qt_gtk_proxy_roots) {
+            if (root.proxy == proxy) {
+                qCDebug(lcQGtkStats, "created proxy widget %s in %.2f ms", root.root, timer.nsecsElapsed() / 1e6);
+                break;
+            }
+        }
+    }
+}
+
 void QGtkStylePrivate::setupGtkWidget(GtkWidget* widget)
 {
     if (Q_GTK_IS_WIDGET(widget)) {
@@ -422,7 +837,7 @@ void QGtkStylePrivate::setupGtkWidget(GtkWidget* widget)
             protoLayout = gtk_fixed_new();
             gtk_container_add((GtkContainer*)(gtkWidgetMap()->value("GtkWindow")), protoLayout);
             QHashableLatin1Literal widgetPath = QHashableLatin1Literal::fromData(strdup("GtkContainer"));
-            gtkWidgetMap()->insert(widgetPath, protoLayout);
+            insertWidget(widgetPath, protoLayout);
         }
         Q_ASSERT(protoLayout);
 
@@ -438,11 +853,44 @@ void QGtkStylePrivate::removeWidgetFromMap(const QHashableLatin1Literal &path)
     WidgetMap::iterator it = map->find(path);
     if (it != map->end()) {
         char* keyData = const_cast<char *>(it.key().data());
+        const int slot = qt_gtk_known_slot(path);
+        if (slot >= 0)
+            qt_gtk_known_widgets[slot] = nullptr;
+        widgetClassIds.remove(it.value());
         map->erase(it);
         free(keyData);
     }
 }
 
+void QGtkStylePrivate::insertWidget(const QHashableLatin1Literal &path, GtkWidget *widget)
+{
+    gtkWidgetMap()->insert(path, widget);
+    const int slot = qt_gtk_known_slot(path);
+    if (slot >= 0) {
+        qt_gtk_known_widgets[slot] = widget;
+        qt_gtk_known_properties[slot] = QGtkStyleProperties();
+    }
+    widgetClassIds.insert(widget, QGtkPixmapCache::intern(path.toString()));
+}
+
+// Returns an id for the class path of a widget from the map. Unlike the
+// widget itself it stays the same when the widgets are recreated.
+quint32 QGtkStylePrivate::widgetClassId(GtkWidget *widget)
+{
+    if (!widget)
+        return 0;
+    QHash<GtkWidget *, quint32>::const_iterator it = widgetClassIds.constFind(widget);
+    if (it != widgetClassIds.constEnd())
+        return it.value();
+    // Not one of ours, fall back to the widget type. Types are never
+    // unregistered, so each type name is only interned once.
+    const GType type = G_OBJECT_TYPE(widget);
+    QHash<GType, quint32>::const_iterator typeIt = widgetTypeIds.constFind(type);
+    if (typeIt == widgetTypeIds.constEnd())
+        typeIt = widgetTypeIds.insert(type, QGtkPixmapCache::intern(QString::fromLatin1(g_type_name(type))));
+    return typeIt.value();
+}
+
 void QGtkStylePrivate::addWidgetToMap(GtkWidget *widget)
 {
     if (Q_GTK_IS_WIDGET(widget)) {
@@ -450,7 +898,7 @@ void QGtkStylePrivate::addWidgetToMap(GtkWidget *widget)
         QHashableLatin1Literal widgetPath = classPath(widget);
 
         removeWidgetFromMap(widgetPath);
-        gtkWidgetMap()->insert(widgetPath, widget);
+        insertWidget(widgetPath, widget);
 #ifdef DUMP_GTK_WIDGET_TREE
         qWarning("Inserted Gtk Widget: %s", widgetPath.data());
 #endif
@@ -490,7 +938,16 @@ QPalette QGtkStylePrivate::gtkWidgetPalette(const QHashableLatin1Literal &gtkWid
 void QGtkStyleUpdateScheduler::updateTheme()
 {
     static QString oldTheme(QLS("qt_not_set"));
-    QPixmapCache::clear();
+    QGtkPixmapCache::invalidate();
+    QGtkDiskCache::themeChanged();
+    QGtkSharedCache::themeChanged();
+    QGtkRenderServer::themeChanged();
+    QGtkStylePrivate::gtkPainter()->themeChanged();
+    QGtkStylePrivate::clearThemeMetrics();
+    for (QGtkStylePrivate *stylePrivate : qAsConst(QGtkStylePrivate::instances)) {
+        if (stylePrivate->prewarmer)
+            stylePrivate->prewarmer->themeChanged();
+    }
 
     QFont font = QGtkStylePrivate::getThemeFont();
     if (QApplication::font() != font)
@@ -514,6 +971,196 @@ void QGtkStyleUpdateScheduler::updateTheme()
     QIconLoader::instance()->updateSystemTheme();
 }
 
+/*! \internal
+ * Returns a pixel metric that depends only on the theme. Layouts ask for
+ * these many times, so the value is kept until the theme changes.
+ */
+int QGtkStylePrivate::themePixelMetric(QStyle::PixelMetric metric) const
+{
+    QHash<int, int>::const_iterator it = themeMetrics.constFind(metric);
+    if (it != themeMetrics.constEnd())
+        return it.value();
+
+    int value = 0;
+    switch (metric) {
+    case QStyle::PM_DefaultFrameWidth: // of a QFrame
+        value = 2;
+        if (GtkStyle *style =
+            gtk_rc_get_style_by_paths(gtk_settings_get_default(),
+                                            "*.GtkScrolledWindow",
+                                            "*.GtkScrolledWindow",
+                                            gtk_window_get_type()))
+            value = qMax(style->xthickness, style->ythickness);
+        break;
+
+    case QStyle::PM_ButtonShiftHorizontal:
+        value = styleProperties("GtkButton").childDisplacementX;
+        break;
+
+    case QStyle::PM_ButtonShiftVertical:
+        value = styleProperties("GtkButton").childDisplacementY;
+        break;
+
+    case QStyle::PM_MenuPanelWidth: {
+        GtkWidget *gtkMenu = gtkWidget("GtkMenu");
+        // horizontal-padding is used by Maemo to get thicker borders
+        value = qMax<int>(gtk_widget_get_style(gtkMenu)->xthickness,
+                          styleProperties("GtkMenu").horizontalPadding);
+        break;
+    }
+
+    case QStyle::PM_ButtonIconSize: {
+        value = 24;
+        GtkSettings *settings = gtk_settings_get_default();
+        gchararray icon_sizes;
+        g_object_get(settings, "gtk-icon-sizes", &icon_sizes, nullptr);
+        QStringList values = QString(QLS(icon_sizes)).split(QLatin1Char(':'));
+        g_free(icon_sizes);
+        QChar splitChar(QLatin1Char(','));
+        for (const QString &size : qAsConst(values)) {
+            if (size.startsWith(QLS("gtk-button="))) {
+                QString iconSize = size.right(size.size() - 11);
+
+                if (iconSize.contains(splitChar))
+                    value = iconSize.split(splitChar)[0].toInt();
+                break;
+            }
+        }
+        break;
+    }
+
+    case QStyle::PM_SliderThickness:
+    case QStyle::PM_SliderControlThickness: {
+        value = styleProperties("GtkHScale").sliderWidth;
+        if (metric == QStyle::PM_SliderControlThickness)
+            value += 2*gtk_widget_get_style(gtkWidget("GtkHScale"))->ythickness;
+        break;
+    }
+
+    case QStyle::PM_ScrollBarExtent: {
+        const QGtkStyleProperties properties = styleProperties("GtkHScrollbar");
+        value = properties.sliderWidth + properties.troughBorder*2;
+        break;
+    }
+
+    case QStyle::PM_SliderLength:
+        value = styleProperties("GtkHScale").sliderLength;
+        break;
+
+    case QStyle::PM_ExclusiveIndicatorWidth:
+    case QStyle::PM_ExclusiveIndicatorHeight:
+    case QStyle::PM_IndicatorWidth:
+    case QStyle::PM_IndicatorHeight: {
+        const QGtkStyleProperties properties = styleProperties("GtkCheckButton");
+        value = properties.indicatorSize + 2 * properties.indicatorSpacing;
+        break;
+    }
+
+    case QStyle::PM_MenuBarVMargin:
+        value = qMax(0, gtk_widget_get_style(gtkWidget("GtkMenuBar"))->ythickness);
+        break;
+
+    case QStyle::PM_ScrollView_ScrollBarSpacing:
+        value = styleProperties("GtkScrolledWindow").scrollbarSpacing;
+        break;
+
+    case QStyle::PM_SubMenuOverlap:
+        value = styleProperties("GtkMenu").horizontalOffset;
+        break;
+
+    default:
+        break;
+    }
+
+    themeMetrics.insert(metric, value);
+    return value;
+}
+
+/*! \internal
+ * Returns a style hint that depends only on the theme and the gtk
+ * settings. Kept until the theme or the toolbar style changes.
+ */
+int QGtkStylePrivate::themeStyleHint(QStyle::StyleHint hint) const
+{
+    QHash<int, int>::const_iterator it = themeHints.constFind(hint);
+    if (it != themeHints.constEnd())
+        return it.value();
+
+    int value = 0;
+    GtkSettings *settings = gtk_settings_get_default();
+    switch (hint) {
+    case QStyle::SH_DialogButtonLayout: {
+        gboolean alternateOrder = 0;
+        g_object_get(settings, "gtk-alternative-button-order", &alternateOrder, nullptr);
+        value = alternateOrder ? QDialogButtonBox::WinLayout : QDialogButtonBox::GnomeLayout;
+        break;
+    }
+
+    case QStyle::SH_ToolButtonStyle: {
+        GtkToolbarStyle toolbar_style = GTK_TOOLBAR_ICONS;
+        g_object_get(gtkWidget("GtkToolbar"), "toolbar-style", &toolbar_style, nullptr);
+        switch (toolbar_style) {
+        case GTK_TOOLBAR_TEXT:
+            value = Qt::ToolButtonTextOnly;
+            break;
+        case GTK_TOOLBAR_BOTH:
+            value = Qt::ToolButtonTextUnderIcon;
+            break;
+        case GTK_TOOLBAR_BOTH_HORIZ:
+            value = Qt::ToolButtonTextBesideIcon;
+            break;
+        case GTK_TOOLBAR_ICONS:
+        default:
+            value = Qt::ToolButtonIconOnly;
+            break;
+        }
+        break;
+    }
+
+    case QStyle::SH_ComboBox_Popup:
+        value = styleProperties("GtkComboBox").appearsAsList ? 0 : 1;
+        break;
+
+    case QStyle::SH_Menu_SubMenuPopupDelay: {
+        gint delay = 225;
+        g_object_get(settings, "gtk-menu-popup-delay", &delay, nullptr);
+        value = delay;
+        break;
+    }
+
+    case QStyle::SH_ScrollView_FrameOnlyAroundContents: // of a non-window
+        value = !styleProperties("GtkScrolledWindow").scrollbarsWithinBevel;
+        break;
+
+    case QStyle::SH_DialogButtonBox_ButtonsHaveIcons: {
+        gboolean buttonsHaveIcons = true;
+        g_object_get(settings, "gtk-button-images", &buttonsHaveIcons, nullptr);
+        value = buttonsHaveIcons;
+        break;
+    }
+
+    case QStyle::SH_UnderlineShortcut: {
+        gboolean underlineShortcut = true;
+        if (!gtk_check_version(2, 12, 0))
+            g_object_get(settings, "gtk-enable-mnemonics", &underlineShortcut, nullptr);
+        value = underlineShortcut;
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    themeHints.insert(hint, value);
+    return value;
+}
+
+void QGtkStylePrivate::clearThemeMetrics()
+{
+    themeMetrics.clear();
+    themeHints.clear();
+}
+
 void QGtkStylePrivate::addWidget(GtkWidget *widget)
 {
     if (widget) {
@@ -554,24 +1201,13 @@ QFont QGtkStylePrivate::getThemeFont()
 
 bool operator==(const QHashableLatin1Literal &l1, const QHashableLatin1Literal &l2)
 {
-    return l1.size() == l2.size() && !qstrcmp(l1.data(), l2.data());
+    return l1.size() == l2.size() && l1.hash() == l2.hash()
+            && (l1.data() == l2.data() || !qstrcmp(l1.data(), l2.data()));
 }
 
-// copied from qHash.cpp
 uint qHash(const QHashableLatin1Literal &key)
 {
-    int n = key.size();
-    const uchar *p = reinterpret_cast<const uchar *>(key.data());
-    uint h = 0;
-    uint g;
-
-    while (n--) {
-        h = (h << 4) + *p++;
-        if ((g = (h & 0xf0000000)) != 0)
-            h ^= g >> 23;
-        h &= ~g;
-    }
-    return h;
+    return key.hash();
 }
 
 QT_END_NAMESPACE
@@ -40,6 +40,8 @@
 #include <QCoreApplication>
 #include <QFileDialog>
 #include <QCommonStyle>
+#include <QPointer>
+#include <QMargins>
 
 #include <private/qcommonstyle_p.h>
 #include "qgtkstyle_p.h"
@@ -49,23 +51,34 @@
 
 QT_BEGIN_NAMESPACE
 
+// FNV-1a, usable in constant expressions so that the hashes of literal
+// widget paths are computed by the compiler
+constexpr uint qt_gtk_path_hash(const char *str, int size)
+{
+    uint h = 2166136261u;
+    for (int i = 0; i < size; ++i)
+        h = (h ^ uchar(str[i])) * 16777619u;
+    return h;
+}
+
 class QHashableLatin1Literal
 {
 public:
-    int size() const { return m_size; }
-    const char *data() const { return m_data; }
+    constexpr int size() const { return m_size; }
+    constexpr const char *data() const { return m_data; }
+    constexpr uint hash() const { return m_hash; }
 
 #ifdef __SUNPRO_CC
         QHashableLatin1Literal(const char* str)
-        : m_size(strlen(str)), m_data(str) {}
+        : m_size(strlen(str)), m_data(str), m_hash(qt_gtk_path_hash(str, m_size)) {}
 #else
     template <int N>
-        QHashableLatin1Literal(const char (&str)[N])
-        : m_size(N - 1), m_data(str) {}
+        constexpr QHashableLatin1Literal(const char (&str)[N])
+        : m_size(N - 1), m_data(str), m_hash(qt_gtk_path_hash(str, N - 1)) {}
 #endif
 
-    QHashableLatin1Literal(const QHashableLatin1Literal &other)
-        : m_size(other.m_size), m_data(other.m_data)
+    constexpr QHashableLatin1Literal(const QHashableLatin1Literal &other)
+        : m_size(other.m_size), m_data(other.m_data), m_hash(other.m_hash)
     {}
 
     QHashableLatin1Literal &operator=(const QHashableLatin1Literal &other)
@@ -74,6 +87,7 @@ public:
             return *this;
         *const_cast<int *>(&m_size) = other.m_size;
         *const_cast<char **>(&m_data) = const_cast<char *>(other.m_data);
+        *const_cast<uint *>(&m_hash) = other.m_hash;
         return *this;
     }
 
@@ -86,11 +100,12 @@ public:
 
 private:
     QHashableLatin1Literal(const char *str, int length)
-        : m_size(length), m_data(str)
+        : m_size(length), m_data(str), m_hash(qt_gtk_path_hash(str, length))
     {}
 
     const int m_size;
     const char *m_data;
+    const uint m_hash;
 };
 
 bool operator==(const QHashableLatin1Literal &l1, const QHashableLatin1Literal &l2);
@@ -104,8 +119,67 @@ typedef struct _XDisplay Display;
 QT_BEGIN_NAMESPACE
 
 class QGtkPainter;
+class QGtkPrewarmer;
 class QGtkStylePrivate;
 
+// Snapshot of the style properties read while painting and measuring.
+// It is filled from a proxy widget on first use and dropped when the
+// theme changes. Properties the widget class does not install keep their
+// defaults.
+struct QGtkStyleProperties
+{
+    void load(GtkWidget *widget);
+
+    bool loaded = false;
+
+    // GtkWidget
+    gboolean interiorFocus = true;
+    gint focusLineWidth = 1;
+    gint focusPadding = 1;
+    gboolean wideSeparators = false;
+    gint separatorHeight = 0;
+
+    // GtkButton
+    gint childDisplacementX = 0;
+    gint childDisplacementY = 0;
+    QMargins innerBorder = QMargins(1, 1, 1, 1);
+
+    // GtkCheckButton, GtkCheckMenuItem
+    gint indicatorSize = 13;
+    gint indicatorSpacing = 2;
+
+    // GtkRange, GtkScale
+    gint sliderWidth = 14;
+    gint sliderLength = 31;
+    gint troughBorder = 1;
+    gint stepperSize = 14;
+    gboolean troughSideDetails = false;
+    gboolean troughUnderSteppers = true;
+
+    // GtkMenu, GtkMenuItem
+    gint horizontalPadding = 0;
+    gint horizontalOffset = 0;
+    GtkShadowType selectedShadowType = GTK_SHADOW_NONE;
+
+    // GtkArrow, GtkMenuItem
+    gfloat arrowScaling = 0.7f;
+
+    // GtkComboBox
+    gboolean appearsAsList = false;
+    gint arrowSize = 15;
+
+    // GtkScrolledWindow
+    gint scrollbarSpacing = 3;
+    gboolean scrollbarsWithinBevel = false;
+
+    // GtkStatusbar, GtkToolbar, GtkMenuBar
+    GtkShadowType shadowType = GTK_SHADOW_NONE;
+
+    // GtkButtonBox
+    gint childMinWidth = 85;
+    gint childMinHeight = 0;
+};
+
 class QGtkStyleFilter : public QObject
 {
 public:
@@ -125,11 +199,15 @@ public:
     ~QGtkStylePrivate();
 
     QGtkStyleFilter filter;
+    QPointer<QGtkPrewarmer> prewarmer;
 
     static QGtkPainter* gtkPainter(QPainter *painter = nullptr);
     static GtkWidget* gtkWidget(const QHashableLatin1Literal &path);
     static GtkStyle* gtkStyle(const QHashableLatin1Literal &path = QHashableLatin1Literal("GtkWindow"));
+    static QGtkStyleProperties styleProperties(const QHashableLatin1Literal &path);
     static void gtkWidgetSetFocus(GtkWidget *widget, bool focus);
+    static quint32 widgetClassId(GtkWidget *widget);
+    static void prerender(QWidget *window);
 
     virtual void initGtkMenu() const;
     virtual void initGtkTreeview() const;
@@ -147,6 +225,10 @@ public:
 
     virtual QPalette gtkWidgetPalette(const QHashableLatin1Literal &gtkWidgetName) const;
 
+    int themePixelMetric(QStyle::PixelMetric metric) const;
+    int themeStyleHint(QStyle::StyleHint hint) const;
+    static void clearThemeMetrics();
+
 protected:
     typedef QHash<QHashableLatin1Literal, GtkWidget*> WidgetMap;
 
@@ -170,10 +252,12 @@ protected:
 
     virtual GtkWidget* getTextColorWidget() const;
     static void setupGtkWidget(GtkWidget* widget);
+    static void insertWidget(const QHashableLatin1Literal &path, GtkWidget *widget);
     static void addWidgetToMap(GtkWidget* widget);
     static void addAllSubWidgets(GtkWidget *widget, gpointer v = nullptr);
     static void addWidget(GtkWidget *widget);
     static void removeWidgetFromMap(const QHashableLatin1Literal &path);
+    static void createProxyWidget(int proxy);
 
     virtual void init();
 
@@ -189,6 +273,10 @@ protected:
 private:
     static QList<QGtkStylePrivate *> instances;
     static WidgetMap *widgetMap;
+    static QHash<GtkWidget *, quint32> widgetClassIds;
+    static QHash<GType, quint32> widgetTypeIds;
+    static QHash<int, int> themeMetrics;
+    static QHash<int, int> themeHints;
     friend class QGtkStyleUpdateScheduler;
 };
 
@@ -5,22 +5,34 @@ TARGET = qt6gtk2-style
 QT += core-private gui-private widgets-private
 
 DEFINES += QT_NO_ANIMATION
+DEFINES += QT6GTK2_HELPER_PATH=\\\"$$LIBEXECDIR/qt6gtk2-helper\\\"
 
 # Input
 HEADERS += qgtk2painter_p.h \
+           qgtkdiskcache_p.h \
            qgtkglobal_p.h \
+           qgtkhelperpool_p.h \
+           qgtkhelperprotocol_p.h \
+           qgtkpixmapcache_p.h \
+           qgtkprewarmer_p.h \
+           qgtkrenderserver_p.h \
+           qgtkscratchpool_p.h \
+           qgtksharedcache_p.h \
+           qgtkstats_p.h \
+           qgtkshmpixmap_p.h \
            qgtkpainter_p.h \
            qgtkstyle_p.h \
            qgtkstyle_p_p.h \
     qstylehelper_p.h
-SOURCES += qgtk2painter.cpp qgtkpainter.cpp qgtkstyle.cpp qgtkstyle_p.cpp \
+SOURCES += qgtk2painter.cpp qgtkdiskcache.cpp qgtkhelperpool.cpp qgtkpainter.cpp qgtkpixmapcache.cpp qgtkprewarmer.cpp qgtkrenderserver.cpp qgtkscratchpool.cpp qgtksharedcache.cpp qgtkshmpixmap.cpp qgtkstats.cpp qgtkstyle.cpp qgtkstyle_p.cpp \
     plugin.cpp \
     qstylehelper.cpp
 
 CONFIG += plugin \
           link_pkgconfig \
 
-PKGCONFIG += gtk+-2.0 x11
+PKGCONFIG += gtk+-2.0 x11 xext
+LIBS += -lrt
 
 target.path = $$PLUGINDIR/styles
 INSTALLS += target
@@ -0,0 +1,6 @@
+include(../../shared/shared.pri)
+
+TEMPLATE = app
+TARGET = tst_qgtkstyle_allocations
+
+SOURCES += tst_qgtkstyle_allocations.cpp
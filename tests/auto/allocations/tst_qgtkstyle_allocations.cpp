@@ -0,0 +1,186 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include <QApplication>
+#include <QImage>
+#include <QPainter>
+#include <QStyleOption>
+#include <QtTest>
+#include <algorithm>
+#include <cstdlib>
+#include "qgtkstyle_p.h"
+#include "qgtkstyle_p_p.h"
+#include "qgtktestelements.h"
+
+// Counts the heap allocations of the current thread while enabled. The
+// hooks replace the malloc family of glibc for the whole process, which
+// also catches operator new, Qt's containers and glib.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+}
+
+static thread_local bool qt_gtk_count_allocations = false;
+static thread_local int qt_gtk_allocations = 0;
+
+extern "C" void *malloc(size_t size) noexcept
+{
+    if (qt_gtk_count_allocations)
+        ++qt_gtk_allocations;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+    if (qt_gtk_count_allocations)
+        ++qt_gtk_allocations;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+    if (qt_gtk_count_allocations)
+        ++qt_gtk_allocations;
+    return __libc_realloc(ptr, size);
+}
+
+class QGtkAllocationCounter
+{
+public:
+    QGtkAllocationCounter() { qt_gtk_allocations = 0; qt_gtk_count_allocations = true; }
+    ~QGtkAllocationCounter() { qt_gtk_count_allocations = false; }
+    int count() const { return qt_gtk_allocations; }
+};
+
+// Paints elements whose theme pixmaps are already cached, as a window
+// does on every repaint, and fails if that allocates anything
+class tst_QGtkStyleAllocations : public QObject
+{
+    Q_OBJECT
+
+public:
+    static void initMain() { qt_gtk_test_init_environment(); }
+
+private slots:
+    void initTestCase();
+
+    void counter();
+    void warmPaint_data();
+    void warmPaint();
+
+private:
+    QStyle *m_style = nullptr;
+};
+
+void tst_QGtkStyleAllocations::initTestCase()
+{
+    if (QGuiApplication::platformName() != QLatin1String("xcb"))
+        QSKIP("The style draws through X, run the test under Xvfb");
+    QGtkStyle *style = new QGtkStyle;
+    if (!QGtkStylePrivate::isThemeAvailable()) {
+        delete style;
+        QSKIP("No gtk theme could be loaded");
+    }
+    QApplication::setStyle(style);
+    m_style = style;
+}
+
+// The hooks have to be in place, or warmPaint() proves nothing
+void tst_QGtkStyleAllocations::counter()
+{
+    int allocations = 0;
+    {
+        QGtkAllocationCounter counter;
+        QString str(64, QLatin1Char('x'));
+        QScopedPointer<QObject> object(new QObject);
+        allocations = counter.count();
+    }
+    QVERIFY(allocations >= 2);
+}
+
+void tst_QGtkStyleAllocations::warmPaint_data()
+{
+    QTest::addColumn<int>("kind");
+    QTest::addColumn<int>("element");
+    QTest::addColumn<int>("state");
+    QTest::addColumn<QSize>("size");
+
+    // the elements the style paints from its cache without any text
+    const struct {
+        QGtkTestElement::Kind kind;
+        int element;
+        const char *name;
+        QSize size;
+    } elements[] = {
+        { QGtkTestElement::Primitive, QStyle::PE_PanelButtonCommand, "PE_PanelButtonCommand", QSize(100, 28) },
+        { QGtkTestElement::Primitive, QStyle::PE_IndicatorCheckBox, "PE_IndicatorCheckBox", QSize(13, 13) },
+        { QGtkTestElement::Primitive, QStyle::PE_IndicatorRadioButton, "PE_IndicatorRadioButton", QSize(13, 13) },
+        { QGtkTestElement::Primitive, QStyle::PE_FrameLineEdit, "PE_FrameLineEdit", QSize(200, 26) },
+        { QGtkTestElement::Primitive, QStyle::PE_PanelLineEdit, "PE_PanelLineEdit", QSize(200, 26) },
+        { QGtkTestElement::Primitive, QStyle::PE_FrameTabWidget, "PE_FrameTabWidget", QSize(300, 200) },
+        { QGtkTestElement::ComplexControl, QStyle::CC_ScrollBar, "CC_ScrollBar", QSize(300, 16) },
+        { QGtkTestElement::ComplexControl, QStyle::CC_Slider, "CC_Slider", QSize(200, 24) },
+        { QGtkTestElement::ComplexControl, QStyle::CC_SpinBox, "CC_SpinBox", QSize(80, 26) },
+        { QGtkTestElement::ComplexControl, QStyle::CC_ComboBox, "CC_ComboBox", QSize(150, 28) }
+    };
+    const QByteArray states[] = { "normal", "hover", "pressed", "disabled" };
+    const QList<QGtkTestState> testStates = qt_gtk_test_states();
+    for (const auto &element : elements) {
+        for (const QGtkTestState &state : testStates) {
+            if (std::find(std::begin(states), std::end(states), state.name) == std::end(states))
+                continue;
+            QTest::addRow("%s/%s", element.name, state.name.constData())
+                    << int(element.kind) << element.element << int(state.state) << element.size;
+        }
+    }
+}
+
+void tst_QGtkStyleAllocations::warmPaint()
+{
+    QFETCH(int, kind);
+    QFETCH(int, element);
+    QFETCH(int, state);
+    QFETCH(QSize, size);
+
+    const QGtkTestElement testElement = { QGtkTestElement::Kind(kind), element, QByteArray() };
+    const std::unique_ptr<QStyleOption> option =
+            qt_gtk_test_option(testElement, QRect(QPoint(0, 0), size), QStyle::State(state), false);
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+
+    // the first paints render the theme pixmaps and let the painter set up
+    for (int i = 0; i < 3; ++i)
+        qt_gtk_test_draw(m_style, testElement, option.get(), &painter);
+
+    int allocations = 0;
+    {
+        QGtkAllocationCounter counter;
+        for (int i = 0; i < 100; ++i)
+            qt_gtk_test_draw(m_style, testElement, option.get(), &painter);
+        allocations = counter.count();
+    }
+    QCOMPARE(allocations, 0);
+}
+
+QTEST_MAIN(tst_QGtkStyleAllocations)
+
+#include "tst_qgtkstyle_allocations.moc"
@@ -0,0 +1,7 @@
+TEMPLATE = subdirs
+
+SUBDIRS += allocations
+
+# golden compares with reference images that have to be generated with
+# QT6GTK2_UPDATE_GOLDENS=1 first, see golden/data/README. It is built
+# and run from its own directory.
@@ -0,0 +1,8 @@
+include(../../shared/shared.pri)
+
+TEMPLATE = app
+TARGET = tst_qgtkstyle_golden
+
+DEFINES += QT6GTK2_GOLDEN_DIR=\\\"$$PWD/data\\\"
+
+SOURCES += tst_qgtkstyle_golden.cpp
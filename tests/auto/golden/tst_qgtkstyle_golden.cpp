@@ -0,0 +1,333 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include <QApplication>
+#include <QDir>
+#include <QImage>
+#include <QPainter>
+#include <QProcess>
+#include <QStyleOption>
+#include <QTemporaryDir>
+#include <QtTest>
+#include "qgtkpixmapcache_p.h"
+#include "qgtkstyle_p.h"
+#include "qgtkstyle_p_p.h"
+#include "qgtktestelements.h"
+
+// Renders every element of the style in each test state with the theme
+// pinned in tests/shared/gtkrc and compares it with the reference image
+// in data/. Each element is compared twice: rendered from scratch, and
+// painted again from the cache.
+//
+// QT6GTK2_UPDATE_GOLDENS=1 writes the renders to data/ instead, after a
+// change that is meant to alter them.
+//
+// fastPath() renders every element again in processes of their own, with
+// QT6GTK2_RENDER_MODE=dual and argb and with and without QT6GTK2_NO_SHM,
+// which are read once per process. Each fast path is compared with the
+// dual render read back without MIT-SHM.
+//
+// Channels may differ by
+// QT6GTK2_GOLDEN_TOLERANCE (default 2). For a failing element the
+// rendered, reference and difference images are saved to
+// QT6GTK2_GOLDEN_OUTPUT (default qt6gtk2-golden in the temporary
+// directory).
+class tst_QGtkStyleGolden : public QObject
+{
+    Q_OBJECT
+
+public:
+    static void initMain()
+    {
+        qt_gtk_test_init_environment();
+        qunsetenv("QT_SCALE_FACTOR");
+        qputenv("QT_ENABLE_HIGHDPI_SCALING", "0");
+        // set by fastPath() for the processes it starts
+        if (qEnvironmentVariableIsSet("QT6GTK2_GOLDEN_RENDER_MODE"))
+            qputenv("QT6GTK2_RENDER_MODE", qgetenv("QT6GTK2_GOLDEN_RENDER_MODE"));
+    }
+
+private slots:
+    void initTestCase();
+
+    void render_data();
+    void render();
+    void fastPath_data();
+    void fastPath();
+    void renderConfig();
+
+private:
+    QImage draw(const QGtkTestElement &element, QStyle::State state) const;
+    void renderBoth(const QGtkTestElement &element, QStyle::State state, QImage *rendered, QImage *cached) const;
+    bool renderConfigs();
+    void compare(const QImage &image, const QImage &reference, const QString &name, const QString &pass);
+
+    QStyle *m_style = nullptr;
+    bool m_update = false;
+    int m_tolerance = 2;
+    QDir m_output;
+    QTemporaryDir m_configDir;
+    int m_configsRendered = 0; // 1 once renderConfigs() succeeded, -1 if it failed
+};
+
+enum {
+    goldenWidth = 100,
+    goldenHeight = 28
+};
+
+// The render mode and whether MIT-SHM is used for each process started by
+// fastPath(), the first one is the reference
+static const struct {
+    const char *name;
+    const char *mode;
+    bool shm;
+} qt_gtk_golden_configs[] = {
+    { "dual", "dual", false },
+    { "dual-shm", "dual", true },
+    { "argb", "argb", false },
+    { "argb-shm", "argb", true }
+};
+
+void tst_QGtkStyleGolden::initTestCase()
+{
+    if (QGuiApplication::platformName() != QLatin1String("xcb"))
+        QSKIP("The style draws through X, run the test under Xvfb");
+    QGtkStyle *style = new QGtkStyle;
+    if (!QGtkStylePrivate::isThemeAvailable()) {
+        delete style;
+        QSKIP("No gtk theme could be loaded");
+    }
+    QApplication::setStyle(style);
+    m_style = style;
+
+    m_update = qEnvironmentVariableIsSet("QT6GTK2_UPDATE_GOLDENS");
+    if (qEnvironmentVariableIsSet("QT6GTK2_GOLDEN_TOLERANCE"))
+        m_tolerance = qEnvironmentVariableIntValue("QT6GTK2_GOLDEN_TOLERANCE");
+    const QString output = qEnvironmentVariable("QT6GTK2_GOLDEN_OUTPUT",
+                                                QDir::temp().filePath(QStringLiteral("qt6gtk2-golden")));
+    QVERIFY(QDir().mkpath(output));
+    m_output = QDir(output);
+    if (m_update)
+        QVERIFY(QDir().mkpath(QStringLiteral(QT6GTK2_GOLDEN_DIR)));
+}
+
+void tst_QGtkStyleGolden::render_data()
+{
+    QTest::addColumn<int>("kind");
+    QTest::addColumn<int>("element");
+    QTest::addColumn<int>("state");
+    QTest::addColumn<QString>("name");
+
+    for (const QGtkTestElement &element : qt_gtk_test_elements()) {
+        for (const QGtkTestState &state : qt_gtk_test_states()) {
+            const QByteArray name = element.name + '-' + state.name;
+            QTest::newRow(name.constData()) << int(element.kind) << element.element << int(state.state)
+                                            << QString::fromLatin1(name);
+        }
+    }
+}
+
+void tst_QGtkStyleGolden::render()
+{
+    QFETCH(int, kind);
+    QFETCH(int, element);
+    QFETCH(int, state);
+    QFETCH(QString, name);
+
+    const QGtkTestElement testElement = { QGtkTestElement::Kind(kind), element, QByteArray() };
+    QImage rendered;
+    QImage cached;
+    renderBoth(testElement, QStyle::State(state), &rendered, &cached);
+
+    const QString goldenPath = QDir(QStringLiteral(QT6GTK2_GOLDEN_DIR)).filePath(name + QLatin1String(".png"));
+    if (m_update) {
+        QVERIFY(rendered.save(goldenPath));
+        return;
+    }
+    QImage golden;
+    if (!golden.load(goldenPath))
+        QFAIL(qPrintable(QStringLiteral("No reference image %1, create it with QT6GTK2_UPDATE_GOLDENS=1")
+                         .arg(goldenPath)));
+    compare(rendered, golden, name, QStringLiteral("rendered"));
+    if (QTest::currentTestFailed())
+        return;
+    compare(cached, golden, name, QStringLiteral("cached"));
+}
+
+void tst_QGtkStyleGolden::fastPath_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QString>("config");
+    QTest::addColumn<QString>("pass");
+
+    for (const QGtkTestElement &element : qt_gtk_test_elements()) {
+        for (const QGtkTestState &state : qt_gtk_test_states()) {
+            const QByteArray name = element.name + '-' + state.name;
+            for (const auto &config : qt_gtk_golden_configs) {
+                for (const char *pass : { "rendered", "cached" }) {
+                    // the reference itself
+                    if (&config == &qt_gtk_golden_configs[0] && qstrcmp(pass, "rendered") == 0)
+                        continue;
+                    QTest::addRow("%s/%s/%s", name.constData(), config.name, pass)
+                            << QString::fromLatin1(name) << QString::fromLatin1(config.name)
+                            << QString::fromLatin1(pass);
+                }
+            }
+        }
+    }
+}
+
+void tst_QGtkStyleGolden::fastPath()
+{
+    QFETCH(QString, name);
+    QFETCH(QString, config);
+    QFETCH(QString, pass);
+
+    if (!m_configsRendered)
+        m_configsRendered = renderConfigs() ? 1 : -1;
+    if (m_configsRendered < 0)
+        QFAIL("Rendering the elements in the render modes failed");
+
+    const QDir dir(m_configDir.path());
+    const QString referencePath = dir.filePath(QLatin1String(qt_gtk_golden_configs[0].name) + QLatin1Char('/')
+                                               + name + QLatin1String("-rendered.png"));
+    const QString path = dir.filePath(config + QLatin1Char('/') + name + QLatin1Char('-') + pass
+                                      + QLatin1String(".png"));
+    QImage reference;
+    QImage image;
+    QVERIFY2(reference.load(referencePath), qPrintable(referencePath));
+    QVERIFY2(image.load(path), qPrintable(path));
+    compare(image.convertToFormat(QImage::Format_ARGB32_Premultiplied), reference, name,
+            config + QLatin1Char('-') + pass);
+}
+
+// Writes every element rendered and cached to QT6GTK2_GOLDEN_RENDER_DIR,
+// run by fastPath() in a process of its own for each configuration
+void tst_QGtkStyleGolden::renderConfig()
+{
+    if (!qEnvironmentVariableIsSet("QT6GTK2_GOLDEN_RENDER_DIR"))
+        QSKIP("Run by fastPath() in a process of its own");
+
+    const QDir dir(qEnvironmentVariable("QT6GTK2_GOLDEN_RENDER_DIR"));
+    for (const QGtkTestElement &element : qt_gtk_test_elements()) {
+        for (const QGtkTestState &state : qt_gtk_test_states()) {
+            const QString name = QString::fromLatin1(element.name + '-' + state.name);
+            QImage rendered;
+            QImage cached;
+            renderBoth(element, state.state, &rendered, &cached);
+            QVERIFY(rendered.save(dir.filePath(name + QLatin1String("-rendered.png"))));
+            QVERIFY(cached.save(dir.filePath(name + QLatin1String("-cached.png"))));
+        }
+    }
+}
+
+bool tst_QGtkStyleGolden::renderConfigs()
+{
+    if (!m_configDir.isValid())
+        return false;
+    for (const auto &config : qt_gtk_golden_configs) {
+        const QString dir = QDir(m_configDir.path()).filePath(QLatin1String(config.name));
+        if (!QDir().mkpath(dir))
+            return false;
+
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        environment.insert(QStringLiteral("QT6GTK2_GOLDEN_RENDER_DIR"), dir);
+        environment.insert(QStringLiteral("QT6GTK2_GOLDEN_RENDER_MODE"), QLatin1String(config.mode));
+        if (config.shm)
+            environment.remove(QStringLiteral("QT6GTK2_NO_SHM"));
+        else
+            environment.insert(QStringLiteral("QT6GTK2_NO_SHM"), QStringLiteral("1"));
+
+        QProcess process;
+        process.setProcessEnvironment(environment);
+        process.setProcessChannelMode(QProcess::ForwardedChannels);
+        process.start(QCoreApplication::applicationFilePath(), { QStringLiteral("-silent"),
+                                                                  QStringLiteral("renderConfig") });
+        if (!process.waitForFinished(300000) || process.exitStatus() != QProcess::NormalExit
+                || process.exitCode() != 0)
+            return false;
+    }
+    return true;
+}
+
+// Renders an element from scratch and then paints it again from the cache
+void tst_QGtkStyleGolden::renderBoth(const QGtkTestElement &element, QStyle::State state, QImage *rendered,
+                                     QImage *cached) const
+{
+    QGtkPixmapCache::clear();
+    *rendered = draw(element, state);
+    *cached = draw(element, state);
+}
+
+QImage tst_QGtkStyleGolden::draw(const QGtkTestElement &element, QStyle::State state) const
+{
+    const QRect rect(0, 0, goldenWidth, goldenHeight);
+    const std::unique_ptr<QStyleOption> option = qt_gtk_test_option(element, rect, state, false);
+    QImage image(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    qt_gtk_test_draw(m_style, element, option.get(), &painter);
+    painter.end();
+    return image;
+}
+
+void tst_QGtkStyleGolden::compare(const QImage &image, const QImage &reference, const QString &name,
+                                  const QString &pass)
+{
+    const QImage golden = reference.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QCOMPARE(image.size(), golden.size());
+
+    QImage diff(image.size(), QImage::Format_ARGB32);
+    diff.fill(Qt::black);
+    int worst = 0;
+    int differing = 0;
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image.constScanLine(y));
+        const QRgb *goldenLine = reinterpret_cast<const QRgb *>(golden.constScanLine(y));
+        QRgb *diffLine = reinterpret_cast<QRgb *>(diff.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            const int delta = qMax(qMax(qAbs(qRed(line[x]) - qRed(goldenLine[x])),
+                                        qAbs(qGreen(line[x]) - qGreen(goldenLine[x]))),
+                                   qMax(qAbs(qBlue(line[x]) - qBlue(goldenLine[x])),
+                                        qAbs(qAlpha(line[x]) - qAlpha(goldenLine[x]))));
+            worst = qMax(worst, delta);
+            if (delta > m_tolerance) {
+                ++differing;
+                diffLine[x] = qRgb(255, 0, 0);
+            } else if (delta) {
+                diffLine[x] = qRgb(delta * 255 / qMax(m_tolerance, 1), delta * 255 / qMax(m_tolerance, 1), 0);
+            }
+        }
+    }
+    if (!differing)
+        return;
+
+    const QString prefix = name + QLatin1Char('-') + pass;
+    image.save(m_output.filePath(prefix + QLatin1String("-actual.png")));
+    golden.save(m_output.filePath(prefix + QLatin1String("-expected.png")));
+    diff.save(m_output.filePath(prefix + QLatin1String("-diff.png")));
+    QFAIL(qPrintable(QStringLiteral("%1: %2 pixels differ by up to %3 (tolerance %4), images saved to %5")
+                     .arg(pass).arg(differing).arg(worst).arg(m_tolerance)
+                     .arg(m_output.filePath(prefix + QLatin1String("-*.png")))));
+}
+
+QTEST_MAIN(tst_QGtkStyleGolden)
+
+#include "tst_qgtkstyle_golden.moc"
@@ -0,0 +1,8 @@
+include(../shared/shared.pri)
+
+TEMPLATE = app
+TARGET = tst_bench_qgtkstyle
+# run by "make benchmark" instead of "make check"
+CONFIG += benchmark
+
+SOURCES += tst_bench_qgtkstyle.cpp
@@ -0,0 +1,429 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include <QApplication>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QFrame>
+#include <QGridLayout>
+#include <QImage>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPainter>
+#include <QPixmapCache>
+#include <QProcess>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QRandomGenerator>
+#include <QSlider>
+#include <QSpinBox>
+#include <QStyleOption>
+#include <QVBoxLayout>
+#include <QtTest>
+#include <private/qhexstring_p.h>
+#include "qgtk2painter_p.h"
+#include "qgtkpixmapcache_p.h"
+#include "qgtkstyle_p.h"
+#include "qgtkstyle_p_p.h"
+#include "qgtktestelements.h"
+
+// Benchmarks of the paint path, startup and layout. Run them under Xvfb,
+// see README.md.
+class tst_QGtkStyleBench : public QObject
+{
+    Q_OBJECT
+
+public:
+    static void initMain() { qt_gtk_test_init_environment(); }
+
+private slots:
+    void initTestCase();
+
+    void draw_data();
+    void draw();
+    void renderThemeKernel_data();
+    void renderThemeKernel();
+    void cacheHit_data();
+    void cacheHit();
+    void firstWindow_data();
+    void firstWindow();
+    void showFirstWindow();
+    void themeMetric_data();
+    void themeMetric();
+    void relayout_data();
+    void relayout();
+
+private:
+    QStyle *m_style = nullptr;
+};
+
+void tst_QGtkStyleBench::initTestCase()
+{
+    if (QGuiApplication::platformName() != QLatin1String("xcb"))
+        QSKIP("The style draws through X, run the benchmarks under Xvfb");
+    QGtkStyle *style = new QGtkStyle;
+    if (!QGtkStylePrivate::isThemeAvailable()) {
+        delete style;
+        QSKIP("No gtk theme could be loaded");
+    }
+    QApplication::setStyle(style);
+    m_style = style;
+}
+
+void tst_QGtkStyleBench::draw_data()
+{
+    QTest::addColumn<int>("kind");
+    QTest::addColumn<int>("element");
+    QTest::addColumn<int>("state");
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<bool>("cold");
+
+    const QList<QSize> sizes = { QSize(16, 16), QSize(100, 28), QSize(400, 300) };
+    for (const QGtkTestElement &element : qt_gtk_test_elements()) {
+        for (const QGtkTestState &state : qt_gtk_test_states()) {
+            for (const QSize &size : sizes) {
+                for (bool cold : { true, false }) {
+                    QTest::addRow("%s/%s/%dx%d/%s", element.name.constData(), state.name.constData(),
+                                  size.width(), size.height(), cold ? "cold" : "warm")
+                            << int(element.kind) << element.element << int(state.state) << size << cold;
+                }
+            }
+        }
+    }
+}
+
+// With a cold cache every iteration renders the element through gtk and
+// reads it back, with a warm one it is only looked up and drawn
+void tst_QGtkStyleBench::draw()
+{
+    QFETCH(int, kind);
+    QFETCH(int, element);
+    QFETCH(int, state);
+    QFETCH(QSize, size);
+    QFETCH(bool, cold);
+
+    const QGtkTestElement testElement = { QGtkTestElement::Kind(kind), element, QByteArray() };
+    const std::unique_ptr<QStyleOption> option =
+            qt_gtk_test_option(testElement, QRect(QPoint(0, 0), size), QStyle::State(state));
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+
+    qt_gtk_test_draw(m_style, testElement, option.get(), &painter);
+    if (cold) {
+        QBENCHMARK {
+            QGtkPixmapCache::clear();
+            qt_gtk_test_draw(m_style, testElement, option.get(), &painter);
+        }
+    } else {
+        QBENCHMARK {
+            qt_gtk_test_draw(m_style, testElement, option.get(), &painter);
+        }
+    }
+}
+
+void tst_QGtkStyleBench::renderThemeKernel_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<bool>("scalar");
+
+    const QList<QSize> sizes = { QSize(16, 16), QSize(100, 28), QSize(400, 300), QSize(1920, 1080) };
+    for (const QSize &size : sizes) {
+        for (bool scalar : { true, false }) {
+            QTest::addRow("%dx%d/%s", size.width(), size.height(), scalar ? "scalar" : "simd")
+                    << size << scalar;
+        }
+    }
+}
+
+// Alpha recovery of renderTheme() on its own: a black and a white
+// rendering in gtk byte order are converted a scanline at a time
+void tst_QGtkStyleBench::renderThemeKernel()
+{
+    QFETCH(QSize, size);
+    QFETCH(bool, scalar);
+
+    const int bytesPerLine = size.width() * 4;
+    QByteArray black(bytesPerLine * size.height(), Qt::Uninitialized);
+    QByteArray white(black.size(), Qt::Uninitialized);
+    QRandomGenerator random(size.width() * size.height());
+    for (int i = 0; i < black.size(); ++i) {
+        const uint alpha = (i / 4) % 3 ? 255 : random.bounded(256);
+        const uint color = random.bounded(256);
+        black[i] = char(color * alpha / 255);
+        white[i] = char(color * alpha / 255 + 255 - alpha);
+    }
+
+    // both kernels have to agree before their speed is of interest
+    QByteArray reference = black;
+    QByteArray converted = black;
+    const QGtkRenderThemeFunc scalarKernel = qt_gtk_render_theme_kernel(true);
+    const QGtkRenderThemeFunc kernel = qt_gtk_render_theme_kernel(scalar);
+    for (int y = 0; y < size.height(); ++y) {
+        const int offset = y * bytesPerLine;
+        scalarKernel(reinterpret_cast<uchar *>(reference.data()) + offset,
+                     reinterpret_cast<const uchar *>(white.constData()) + offset, size.width());
+        kernel(reinterpret_cast<uchar *>(converted.data()) + offset,
+               reinterpret_cast<const uchar *>(white.constData()) + offset, size.width());
+    }
+    QCOMPARE(converted, reference);
+
+    // the data is converted over and over again, which costs the same
+    uchar *bdata = reinterpret_cast<uchar *>(converted.data());
+    const uchar *wdata = reinterpret_cast<const uchar *>(white.constData());
+    QBENCHMARK {
+        for (int y = 0; y < size.height(); ++y)
+            kernel(bdata + y * bytesPerLine, wdata + y * bytesPerLine, size.width());
+    }
+}
+
+// How elements were keyed in QPixmapCache before QGtkPixmapKey
+static QString qt_gtk_string_key(const char *detail, GtkStateType state, GtkShadowType shadow,
+                                 const QSize &size, GtkWidget *widget)
+{
+    return QLatin1String(detail)
+           % HexString<uint>(state)
+           % HexString<uint>(shadow)
+           % HexString<uint>(size.width())
+           % HexString<uint>(size.height())
+           % HexString<quint64>(quint64(quintptr(widget)));
+}
+
+void tst_QGtkStyleBench::cacheHit_data()
+{
+    QTest::addColumn<QByteArray>("lookup");
+
+    QTest::newRow("string key") << QByteArray("string");
+    QTest::newRow("binary key") << QByteArray("binary");
+    QTest::newRow("style paint") << QByteArray("paint");
+}
+
+// Cost of a cache hit: building the key of a button and finding its
+// pixmap, once with the string keys in QPixmapCache that were used before
+// and once with QGtkPixmapKey in QGtkPixmapCache. The last row is the
+// whole warm paint of the button through the style for comparison.
+void tst_QGtkStyleBench::cacheHit()
+{
+    QFETCH(QByteArray, lookup);
+
+    static const char detail[] = "button";
+    const QSize size(100, 28);
+    GtkWidget *gtkWidget = QGtkStylePrivate::gtkWidget("GtkButton");
+    GtkStyle *style = QGtkStylePrivate::gtkStyle();
+    QVERIFY(gtkWidget);
+    QPixmap pixmap(size);
+    pixmap.fill(Qt::gray);
+    QPixmap found;
+
+    if (lookup == "string") {
+        QPixmapCache::insert(qt_gtk_string_key(detail, GTK_STATE_NORMAL, GTK_SHADOW_OUT, size, gtkWidget), pixmap);
+        QBENCHMARK {
+            const QString key = qt_gtk_string_key(detail, GTK_STATE_NORMAL, GTK_SHADOW_OUT, size, gtkWidget);
+            QPixmapCache::find(key, &found);
+        }
+        QVERIFY(!found.isNull());
+    } else if (lookup == "binary") {
+        QGtkPixmapKey key;
+        memset(&key, 0, sizeof(key));
+        key.detail = quint64(quintptr(detail));
+        key.style = quint64(quintptr(style));
+        key.width = size.width();
+        key.height = size.height();
+        key.widget = QGtkStylePrivate::widgetClassId(gtkWidget);
+        key.element = QGtkPixmapKey::Box;
+        key.state = GTK_STATE_NORMAL;
+        key.shadow = GTK_SHADOW_OUT;
+        QGtkPixmapCache::insert(key, pixmap);
+        QBENCHMARK {
+            key.widget = QGtkStylePrivate::widgetClassId(gtkWidget);
+            QGtkPixmapCache::find(key, &found);
+        }
+        QVERIFY(!found.isNull());
+    } else {
+        const QGtkTestElement button = { QGtkTestElement::Primitive, QStyle::PE_PanelButtonCommand, QByteArray() };
+        const std::unique_ptr<QStyleOption> option =
+                qt_gtk_test_option(button, QRect(QPoint(0, 0), size), qt_gtk_test_states().constFirst().state);
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        qt_gtk_test_draw(m_style, button, option.get(), &painter);
+        QBENCHMARK {
+            qt_gtk_test_draw(m_style, button, option.get(), &painter);
+        }
+    }
+}
+
+void tst_QGtkStyleBench::firstWindow_data()
+{
+    QTest::addColumn<bool>("eager");
+
+    QTest::newRow("lazy widgets") << false;
+    QTest::newRow("eager widgets") << true;
+}
+
+// Time from starting a process to its first window being exposed. The
+// benchmark starts itself to run showFirstWindow(), once with the gtk
+// proxy widgets created on first use and once with all of them created
+// up front.
+void tst_QGtkStyleBench::firstWindow()
+{
+    QFETCH(bool, eager);
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("QT6GTK2_BENCH_FIRST_WINDOW"), QStringLiteral("1"));
+    if (eager)
+        environment.insert(QStringLiteral("QT6GTK2_EAGER_WIDGETS"), QStringLiteral("1"));
+    else
+        environment.remove(QStringLiteral("QT6GTK2_EAGER_WIDGETS"));
+
+    QProcess process;
+    process.setProcessEnvironment(environment);
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    const QStringList arguments = { QStringLiteral("-silent"), QStringLiteral("showFirstWindow") };
+    QBENCHMARK {
+        process.start(QCoreApplication::applicationFilePath(), arguments);
+        QVERIFY(process.waitForFinished(30000));
+        QCOMPARE(process.exitStatus(), QProcess::NormalExit);
+        QCOMPARE(process.exitCode(), 0);
+    }
+}
+
+// Shows a window with the controls of a small tool, run by firstWindow()
+void tst_QGtkStyleBench::showFirstWindow()
+{
+    if (!qEnvironmentVariableIsSet("QT6GTK2_BENCH_FIRST_WINDOW"))
+        QSKIP("Run by firstWindow() in a process of its own");
+
+    QWidget window;
+    QVBoxLayout *layout = new QVBoxLayout(&window);
+    layout->addWidget(new QLineEdit);
+    QComboBox *comboBox = new QComboBox;
+    comboBox->addItems({ QStringLiteral("First"), QStringLiteral("Second") });
+    layout->addWidget(comboBox);
+    layout->addWidget(new QSpinBox);
+    layout->addWidget(new QCheckBox(QStringLiteral("Option")));
+    layout->addWidget(new QSlider(Qt::Horizontal));
+    QProgressBar *progressBar = new QProgressBar;
+    progressBar->setValue(40);
+    layout->addWidget(progressBar);
+    layout->addWidget(new QPushButton(QStringLiteral("Run")));
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+}
+
+void tst_QGtkStyleBench::themeMetric_data()
+{
+    QTest::addColumn<int>("metric");
+    QTest::addColumn<int>("hint");
+    QTest::addColumn<bool>("frame");
+    QTest::addColumn<bool>("memoized");
+
+    // The frame width is only asked from gtk for frames
+    const struct {
+        const char *name;
+        int metric;
+        int hint;
+        bool frame;
+    } metrics[] = {
+        { "PM_ButtonIconSize", QStyle::PM_ButtonIconSize, -1, false },
+        { "PM_DefaultFrameWidth", QStyle::PM_DefaultFrameWidth, -1, true },
+        { "PM_ScrollBarExtent", QStyle::PM_ScrollBarExtent, -1, false },
+        { "SH_DialogButtonLayout", -1, QStyle::SH_DialogButtonLayout, false },
+        { "SH_Menu_SubMenuPopupDelay", -1, QStyle::SH_Menu_SubMenuPopupDelay, false }
+    };
+    for (const auto &metric : metrics) {
+        for (bool memoized : { true, false }) {
+            QTest::addRow("%s/%s", metric.name, memoized ? "memoized" : "queried")
+                    << metric.metric << metric.hint << metric.frame << memoized;
+        }
+    }
+}
+
+// A single theme metric or hint, answered from the memo or queried from
+// gtk again as it was on every call before the memo
+void tst_QGtkStyleBench::themeMetric()
+{
+    QFETCH(int, metric);
+    QFETCH(int, hint);
+    QFETCH(bool, frame);
+    QFETCH(bool, memoized);
+
+    QFrame frameWidget;
+    const QWidget *widget = frame ? &frameWidget : nullptr;
+    int value = 0;
+    if (metric >= 0) {
+        QBENCHMARK {
+            if (!memoized)
+                QGtkStylePrivate::clearThemeMetrics();
+            value += m_style->pixelMetric(QStyle::PixelMetric(metric), nullptr, widget);
+        }
+    } else {
+        QBENCHMARK {
+            if (!memoized)
+                QGtkStylePrivate::clearThemeMetrics();
+            value += m_style->styleHint(QStyle::StyleHint(hint));
+        }
+    }
+    Q_UNUSED(value);
+}
+
+void tst_QGtkStyleBench::relayout_data()
+{
+    QTest::addColumn<bool>("memoized");
+
+    QTest::newRow("memoized") << true;
+    QTest::newRow("queried") << false;
+}
+
+// Recomputes the layout of a form with a few hundred controls, which
+// asks the style for size hints, margins and spacings. The second row
+// drops the memoized metrics before each relayout.
+void tst_QGtkStyleBench::relayout()
+{
+    QFETCH(bool, memoized);
+
+    QWidget window;
+    QGridLayout *layout = new QGridLayout(&window);
+    for (int row = 0; row < 60; ++row) {
+        layout->addWidget(new QLabel(QStringLiteral("Field %1").arg(row)), row, 0);
+        layout->addWidget(new QLineEdit, row, 1);
+        QComboBox *comboBox = new QComboBox;
+        comboBox->addItem(QStringLiteral("Choice"));
+        layout->addWidget(comboBox, row, 2);
+        layout->addWidget(new QSpinBox, row, 3);
+        layout->addWidget(new QCheckBox(QStringLiteral("Enabled")), row, 4);
+        layout->addWidget(new QPushButton(QStringLiteral("Edit")), row, 5);
+    }
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+
+    const QList<QWidget *> widgets = window.findChildren<QWidget *>();
+    QBENCHMARK {
+        if (!memoized)
+            QGtkStylePrivate::clearThemeMetrics();
+        for (QWidget *widget : widgets)
+            widget->updateGeometry();
+        layout->activate();
+    }
+}
+
+QTEST_MAIN(tst_QGtkStyleBench)
+
+#include "tst_bench_qgtkstyle.moc"
@@ -0,0 +1,447 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#include "qgtktestelements.h"
+
+#include <QApplication>
+#include <QMetaEnum>
+#include <QPainter>
+#include <QStyleOption>
+
+QT_BEGIN_NAMESPACE
+
+void qt_gtk_test_init_environment()
+{
+    qputenv("GTK2_RC_FILES", QT6GTK2_TEST_GTKRC);
+    qputenv("QT6GTK2_NO_DISK_CACHE", "1");
+    qputenv("QT6GTK2_NO_SPECULATION", "1");
+    qunsetenv("QT6GTK2_SHARED_CACHE");
+    qunsetenv("QT6GTK2_PRERENDER");
+    qunsetenv("QT6GTK2_PREWARM");
+    qunsetenv("QT6GTK2_HELPERS");
+    qunsetenv("QT6GTK2_VERIFY");
+    qunsetenv("QT6GTK2_RENDER_MODE");
+    qunsetenv("QT_STYLE_OVERRIDE");
+}
+
+template <typename Enum>
+static void qt_gtk_add_elements(QList<QGtkTestElement> *elements, QGtkTestElement::Kind kind, int customBase)
+{
+    const QMetaEnum metaEnum = QMetaEnum::fromType<Enum>();
+    QList<int> seen;
+    for (int i = 0; i < metaEnum.keyCount(); ++i) {
+        const int value = metaEnum.value(i);
+        // skip the custom ranges and aliases of the same value
+        if (value >= customBase || seen.contains(value))
+            continue;
+        seen.append(value);
+        elements->append({ kind, value, QByteArray(metaEnum.key(i)) });
+    }
+}
+
+QList<QGtkTestElement> qt_gtk_test_elements()
+{
+    QList<QGtkTestElement> elements;
+    qt_gtk_add_elements<QStyle::PrimitiveElement>(&elements, QGtkTestElement::Primitive, QStyle::PE_CustomBase);
+    qt_gtk_add_elements<QStyle::ControlElement>(&elements, QGtkTestElement::Control, QStyle::CE_CustomBase);
+    qt_gtk_add_elements<QStyle::ComplexControl>(&elements, QGtkTestElement::ComplexControl, QStyle::CC_CustomBase);
+    return elements;
+}
+
+QList<QGtkTestState> qt_gtk_test_states()
+{
+    const QStyle::State enabled = QStyle::State_Enabled | QStyle::State_Active | QStyle::State_Horizontal;
+    return {
+        { "normal", enabled | QStyle::State_Raised | QStyle::State_Off },
+        { "hover", enabled | QStyle::State_Raised | QStyle::State_Off | QStyle::State_MouseOver },
+        { "pressed", enabled | QStyle::State_Sunken | QStyle::State_Off },
+        { "checked", enabled | QStyle::State_On | QStyle::State_Selected },
+        { "focused", enabled | QStyle::State_Raised | QStyle::State_Off | QStyle::State_HasFocus },
+        { "disabled", QStyle::State_Active | QStyle::State_Horizontal | QStyle::State_Raised | QStyle::State_Off }
+    };
+}
+
+static std::unique_ptr<QStyleOption> qt_gtk_primitive_option(int element, bool withText)
+{
+    switch (element) {
+    case QStyle::PE_Frame:
+    case QStyle::PE_FrameDockWidget:
+    case QStyle::PE_FrameGroupBox:
+    case QStyle::PE_FrameLineEdit:
+    case QStyle::PE_FrameMenu:
+    case QStyle::PE_FrameStatusBarItem:
+    case QStyle::PE_FrameWindow:
+    case QStyle::PE_PanelLineEdit:
+    case QStyle::PE_PanelMenu:
+    case QStyle::PE_PanelTipLabel: {
+        std::unique_ptr<QStyleOptionFrame> frame(new QStyleOptionFrame);
+        frame->lineWidth = 1;
+        frame->frameShape = QFrame::StyledPanel;
+        return frame;
+    }
+    case QStyle::PE_FrameTabWidget: {
+        std::unique_ptr<QStyleOptionTabWidgetFrame> frame(new QStyleOptionTabWidgetFrame);
+        frame->lineWidth = 1;
+        frame->shape = QTabBar::RoundedNorth;
+        frame->tabBarSize = QSize(60, 24);
+        frame->tabBarRect = QRect(0, 0, 60, 24);
+        frame->selectedTabRect = QRect(0, 0, 30, 24);
+        return frame;
+    }
+    case QStyle::PE_FrameTabBarBase: {
+        std::unique_ptr<QStyleOptionTabBarBase> base(new QStyleOptionTabBarBase);
+        base->shape = QTabBar::RoundedNorth;
+        base->tabBarRect = QRect(0, 0, 60, 24);
+        base->selectedTabRect = QRect(0, 0, 30, 24);
+        return base;
+    }
+    case QStyle::PE_FrameFocusRect: {
+        std::unique_ptr<QStyleOptionFocusRect> focus(new QStyleOptionFocusRect);
+        focus->backgroundColor = QApplication::palette().color(QPalette::Window);
+        return focus;
+    }
+    case QStyle::PE_FrameDefaultButton:
+    case QStyle::PE_FrameButtonBevel:
+    case QStyle::PE_PanelButtonBevel:
+    case QStyle::PE_PanelButtonCommand:
+    case QStyle::PE_IndicatorCheckBox:
+    case QStyle::PE_IndicatorRadioButton: {
+        std::unique_ptr<QStyleOptionButton> button(new QStyleOptionButton);
+        if (withText)
+            button->text = QStringLiteral("Button");
+        return button;
+    }
+    case QStyle::PE_FrameButtonTool:
+    case QStyle::PE_PanelButtonTool:
+    case QStyle::PE_IndicatorButtonDropDown: {
+        std::unique_ptr<QStyleOptionToolButton> button(new QStyleOptionToolButton);
+        button->subControls = QStyle::SC_ToolButton | QStyle::SC_ToolButtonMenu;
+        button->features = QStyleOptionToolButton::MenuButtonPopup;
+        return button;
+    }
+    case QStyle::PE_IndicatorHeaderArrow: {
+        std::unique_ptr<QStyleOptionHeader> header(new QStyleOptionHeader);
+        header->sortIndicator = QStyleOptionHeader::SortDown;
+        return header;
+    }
+    case QStyle::PE_PanelItemViewItem:
+    case QStyle::PE_PanelItemViewRow:
+    case QStyle::PE_IndicatorItemViewItemCheck: {
+        std::unique_ptr<QStyleOptionViewItem> item(new QStyleOptionViewItem);
+        item->features = QStyleOptionViewItem::HasDisplay | QStyleOptionViewItem::HasCheckIndicator;
+        item->viewItemPosition = QStyleOptionViewItem::OnlyOne;
+        if (withText)
+            item->text = QStringLiteral("Item");
+        return item;
+    }
+    case QStyle::PE_IndicatorTabTear:
+    case QStyle::PE_IndicatorTabTearRight: {
+        std::unique_ptr<QStyleOptionTab> tab(new QStyleOptionTab);
+        tab->shape = QTabBar::RoundedNorth;
+        return tab;
+    }
+    case QStyle::PE_PanelToolBar: {
+        std::unique_ptr<QStyleOptionToolBar> toolBar(new QStyleOptionToolBar);
+        toolBar->toolBarArea = Qt::TopToolBarArea;
+        toolBar->positionOfLine = QStyleOptionToolBar::OnlyOne;
+        toolBar->positionWithinLine = QStyleOptionToolBar::OnlyOne;
+        toolBar->features = QStyleOptionToolBar::Movable;
+        toolBar->lineWidth = 1;
+        return toolBar;
+    }
+    case QStyle::PE_IndicatorSpinUp:
+    case QStyle::PE_IndicatorSpinDown:
+    case QStyle::PE_IndicatorSpinPlus:
+    case QStyle::PE_IndicatorSpinMinus: {
+        std::unique_ptr<QStyleOptionSpinBox> spinBox(new QStyleOptionSpinBox);
+        spinBox->stepEnabled = QAbstractSpinBox::StepUpEnabled | QAbstractSpinBox::StepDownEnabled;
+        return spinBox;
+    }
+    case QStyle::PE_IndicatorProgressChunk: {
+        std::unique_ptr<QStyleOptionProgressBar> progressBar(new QStyleOptionProgressBar);
+        progressBar->maximum = 100;
+        progressBar->progress = 60;
+        return progressBar;
+    }
+    default:
+        return std::unique_ptr<QStyleOption>(new QStyleOption);
+    }
+}
+
+static std::unique_ptr<QStyleOption> qt_gtk_slider_option(int maximum)
+{
+    std::unique_ptr<QStyleOptionSlider> slider(new QStyleOptionSlider);
+    slider->orientation = Qt::Horizontal;
+    slider->maximum = maximum;
+    slider->sliderPosition = maximum / 3;
+    slider->sliderValue = maximum / 3;
+    slider->singleStep = 1;
+    slider->pageStep = maximum / 10;
+    slider->tickPosition = QSlider::TicksBelow;
+    slider->tickInterval = maximum / 10;
+    slider->subControls = QStyle::SC_All;
+    return slider;
+}
+
+static std::unique_ptr<QStyleOption> qt_gtk_control_option(int element, bool withText)
+{
+    switch (element) {
+    case QStyle::CE_PushButton:
+    case QStyle::CE_PushButtonBevel:
+    case QStyle::CE_PushButtonLabel:
+    case QStyle::CE_CheckBox:
+    case QStyle::CE_CheckBoxLabel:
+    case QStyle::CE_RadioButton:
+    case QStyle::CE_RadioButtonLabel: {
+        std::unique_ptr<QStyleOptionButton> button(new QStyleOptionButton);
+        if (withText)
+            button->text = QStringLiteral("Button");
+        return button;
+    }
+    case QStyle::CE_TabBarTab:
+    case QStyle::CE_TabBarTabShape:
+    case QStyle::CE_TabBarTabLabel: {
+        std::unique_ptr<QStyleOptionTab> tab(new QStyleOptionTab);
+        tab->shape = QTabBar::RoundedNorth;
+        tab->position = QStyleOptionTab::Middle;
+        tab->selectedPosition = QStyleOptionTab::NotAdjacent;
+        if (withText)
+            tab->text = QStringLiteral("Tab");
+        return tab;
+    }
+    case QStyle::CE_ProgressBar:
+    case QStyle::CE_ProgressBarGroove:
+    case QStyle::CE_ProgressBarContents:
+    case QStyle::CE_ProgressBarLabel: {
+        std::unique_ptr<QStyleOptionProgressBar> progressBar(new QStyleOptionProgressBar);
+        progressBar->maximum = 100;
+        progressBar->progress = 60;
+        progressBar->textVisible = withText;
+        if (withText)
+            progressBar->text = QStringLiteral("60%");
+        return progressBar;
+    }
+    case QStyle::CE_MenuItem:
+    case QStyle::CE_MenuScroller:
+    case QStyle::CE_MenuVMargin:
+    case QStyle::CE_MenuHMargin:
+    case QStyle::CE_MenuTearoff:
+    case QStyle::CE_MenuEmptyArea:
+    case QStyle::CE_MenuBarItem:
+    case QStyle::CE_MenuBarEmptyArea: {
+        std::unique_ptr<QStyleOptionMenuItem> menuItem(new QStyleOptionMenuItem);
+        menuItem->menuItemType = QStyleOptionMenuItem::Normal;
+        menuItem->checkType = QStyleOptionMenuItem::NonExclusive;
+        menuItem->menuHasCheckableItems = true;
+        menuItem->maxIconWidth = 16;
+        if (withText)
+            menuItem->text = QStringLiteral("Item\tCtrl+I");
+        return menuItem;
+    }
+    case QStyle::CE_ToolButtonLabel: {
+        std::unique_ptr<QStyleOptionToolButton> button(new QStyleOptionToolButton);
+        button->toolButtonStyle = Qt::ToolButtonTextOnly;
+        if (withText)
+            button->text = QStringLiteral("Tool");
+        return button;
+    }
+    case QStyle::CE_Header:
+    case QStyle::CE_HeaderSection:
+    case QStyle::CE_HeaderLabel:
+    case QStyle::CE_HeaderEmptyArea: {
+        std::unique_ptr<QStyleOptionHeader> header(new QStyleOptionHeader);
+        header->position = QStyleOptionHeader::Middle;
+        header->sortIndicator = QStyleOptionHeader::SortUp;
+        if (withText)
+            header->text = QStringLiteral("Header");
+        return header;
+    }
+    case QStyle::CE_ToolBoxTab:
+    case QStyle::CE_ToolBoxTabShape:
+    case QStyle::CE_ToolBoxTabLabel: {
+        std::unique_ptr<QStyleOptionToolBox> toolBox(new QStyleOptionToolBox);
+        toolBox->position = QStyleOptionToolBox::Middle;
+        if (withText)
+            toolBox->text = QStringLiteral("Page");
+        return toolBox;
+    }
+    case QStyle::CE_SizeGrip: {
+        std::unique_ptr<QStyleOptionSizeGrip> sizeGrip(new QStyleOptionSizeGrip);
+        sizeGrip->corner = Qt::BottomRightCorner;
+        return sizeGrip;
+    }
+    case QStyle::CE_ScrollBarAddLine:
+    case QStyle::CE_ScrollBarSubLine:
+    case QStyle::CE_ScrollBarAddPage:
+    case QStyle::CE_ScrollBarSubPage:
+    case QStyle::CE_ScrollBarSlider:
+    case QStyle::CE_ScrollBarFirst:
+    case QStyle::CE_ScrollBarLast:
+        return qt_gtk_slider_option(1000);
+    case QStyle::CE_RubberBand: {
+        std::unique_ptr<QStyleOptionRubberBand> rubberBand(new QStyleOptionRubberBand);
+        rubberBand->shape = QRubberBand::Rectangle;
+        return rubberBand;
+    }
+    case QStyle::CE_DockWidgetTitle: {
+        std::unique_ptr<QStyleOptionDockWidget> dockWidget(new QStyleOptionDockWidget);
+        dockWidget->closable = true;
+        dockWidget->floatable = true;
+        dockWidget->movable = true;
+        if (withText)
+            dockWidget->title = QStringLiteral("Dock");
+        return dockWidget;
+    }
+    case QStyle::CE_ComboBoxLabel: {
+        std::unique_ptr<QStyleOptionComboBox> comboBox(new QStyleOptionComboBox);
+        if (withText)
+            comboBox->currentText = QStringLiteral("Choice");
+        return comboBox;
+    }
+    case QStyle::CE_ToolBar: {
+        std::unique_ptr<QStyleOptionToolBar> toolBar(new QStyleOptionToolBar);
+        toolBar->toolBarArea = Qt::TopToolBarArea;
+        toolBar->positionOfLine = QStyleOptionToolBar::OnlyOne;
+        toolBar->positionWithinLine = QStyleOptionToolBar::OnlyOne;
+        toolBar->lineWidth = 1;
+        return toolBar;
+    }
+    case QStyle::CE_ItemViewItem: {
+        std::unique_ptr<QStyleOptionViewItem> item(new QStyleOptionViewItem);
+        item->features = QStyleOptionViewItem::HasDisplay;
+        item->viewItemPosition = QStyleOptionViewItem::OnlyOne;
+        item->displayAlignment = Qt::AlignLeft | Qt::AlignVCenter;
+        if (withText)
+            item->text = QStringLiteral("Item");
+        return item;
+    }
+    case QStyle::CE_ShapedFrame: {
+        std::unique_ptr<QStyleOptionFrame> frame(new QStyleOptionFrame);
+        frame->lineWidth = 1;
+        frame->frameShape = QFrame::StyledPanel;
+        return frame;
+    }
+    default:
+        return std::unique_ptr<QStyleOption>(new QStyleOption);
+    }
+}
+
+static std::unique_ptr<QStyleOption> qt_gtk_complex_option(int element, bool withText)
+{
+    switch (element) {
+    case QStyle::CC_SpinBox: {
+        std::unique_ptr<QStyleOptionSpinBox> spinBox(new QStyleOptionSpinBox);
+        spinBox->stepEnabled = QAbstractSpinBox::StepUpEnabled | QAbstractSpinBox::StepDownEnabled;
+        spinBox->frame = true;
+        spinBox->subControls = QStyle::SC_All;
+        return spinBox;
+    }
+    case QStyle::CC_ComboBox: {
+        std::unique_ptr<QStyleOptionComboBox> comboBox(new QStyleOptionComboBox);
+        comboBox->frame = true;
+        comboBox->subControls = QStyle::SC_All;
+        if (withText)
+            comboBox->currentText = QStringLiteral("Choice");
+        return comboBox;
+    }
+    case QStyle::CC_ScrollBar:
+        return qt_gtk_slider_option(1000);
+    case QStyle::CC_Slider:
+    case QStyle::CC_Dial:
+        return qt_gtk_slider_option(100);
+    case QStyle::CC_ToolButton: {
+        std::unique_ptr<QStyleOptionToolButton> button(new QStyleOptionToolButton);
+        button->subControls = QStyle::SC_ToolButton | QStyle::SC_ToolButtonMenu;
+        button->features = QStyleOptionToolButton::MenuButtonPopup;
+        button->toolButtonStyle = Qt::ToolButtonTextOnly;
+        if (withText)
+            button->text = QStringLiteral("Tool");
+        return button;
+    }
+    case QStyle::CC_TitleBar: {
+        std::unique_ptr<QStyleOptionTitleBar> titleBar(new QStyleOptionTitleBar);
+        titleBar->subControls = QStyle::SC_All;
+        titleBar->titleBarFlags = Qt::Window | Qt::WindowTitleHint | Qt::WindowSystemMenuHint
+                                  | Qt::WindowMinMaxButtonsHint | Qt::WindowCloseButtonHint;
+        if (withText)
+            titleBar->text = QStringLiteral("Window");
+        return titleBar;
+    }
+    case QStyle::CC_GroupBox: {
+        std::unique_ptr<QStyleOptionGroupBox> groupBox(new QStyleOptionGroupBox);
+        groupBox->subControls = QStyle::SC_GroupBoxFrame | QStyle::SC_GroupBoxLabel | QStyle::SC_GroupBoxCheckBox;
+        groupBox->lineWidth = 1;
+        groupBox->textAlignment = Qt::AlignLeft;
+        if (withText)
+            groupBox->text = QStringLiteral("Group");
+        return groupBox;
+    }
+    default: {
+        std::unique_ptr<QStyleOptionComplex> complex(new QStyleOptionComplex);
+        complex->subControls = QStyle::SC_All;
+        return complex;
+    }
+    }
+}
+
+std::unique_ptr<QStyleOption> qt_gtk_test_option(const QGtkTestElement &element, const QRect &rect,
+                                                 QStyle::State state, bool withText)
+{
+    std::unique_ptr<QStyleOption> option;
+    switch (element.kind) {
+    case QGtkTestElement::Primitive:
+        option = qt_gtk_primitive_option(element.element, withText);
+        break;
+    case QGtkTestElement::Control:
+        option = qt_gtk_control_option(element.element, withText);
+        break;
+    case QGtkTestElement::ComplexControl:
+        option = qt_gtk_complex_option(element.element, withText);
+        break;
+    }
+    option->rect = rect;
+    option->state = state;
+    option->palette = QApplication::palette();
+    option->fontMetrics = QFontMetrics(QApplication::font());
+    if (QStyleOptionMenuItem *menuItem = qstyleoption_cast<QStyleOptionMenuItem *>(option.get())) {
+        menuItem->menuRect = rect;
+        menuItem->checked = state.testFlag(QStyle::State_On);
+    }
+    return option;
+}
+
+void qt_gtk_test_draw(const QStyle *style, const QGtkTestElement &element, const QStyleOption *option,
+                      QPainter *painter)
+{
+    switch (element.kind) {
+    case QGtkTestElement::Primitive:
+        style->drawPrimitive(QStyle::PrimitiveElement(element.element), option, painter);
+        break;
+    case QGtkTestElement::Control:
+        style->drawControl(QStyle::ControlElement(element.element), option, painter);
+        break;
+    case QGtkTestElement::ComplexControl:
+        style->drawComplexControl(QStyle::ComplexControl(element.element),
+                                  qstyleoption_cast<const QStyleOptionComplex *>(option), painter);
+        break;
+    }
+}
+
+QT_END_NAMESPACE
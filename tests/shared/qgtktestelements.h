@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2015 The Qt Company Ltd.                                *
+ *   Copyright (C) 2016-2023 Ilya Kotov, forkotov02@ya.ru                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.         *
+ ***************************************************************************/
+
+#ifndef QGTKTESTELEMENTS_H
+#define QGTKTESTELEMENTS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QStyle>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+
+class QPainter;
+class QStyleOption;
+
+// Shared by the tests and benchmarks of the style. They compile the style
+// sources in and create a QGtkStyle themselves, so no plugin has to be
+// installed.
+
+// Pins the theme to tests/shared/gtkrc and turns off everything that
+// renders in the background or keeps elements between runs. Has to be
+// called before the QApplication is created.
+void qt_gtk_test_init_environment();
+
+// One style element, e.g. PE_Frame or CC_ScrollBar
+struct QGtkTestElement
+{
+    enum Kind
+    {
+        Primitive,
+        Control,
+        ComplexControl
+    };
+
+    Kind kind;
+    int element;
+    QByteArray name;
+};
+
+// Every primitive, control and complex control QStyle defines
+QList<QGtkTestElement> qt_gtk_test_elements();
+
+struct QGtkTestState
+{
+    QByteArray name;
+    QStyle::State state;
+};
+
+// Normal, hover, pressed, checked, focused and disabled
+QList<QGtkTestState> qt_gtk_test_states();
+
+// Returns an option of the type the style expects for element, filled
+// in like the widget that draws it would. Labels are left empty unless
+// withText is set, so that renders do not depend on the fonts installed.
+std::unique_ptr<QStyleOption> qt_gtk_test_option(const QGtkTestElement &element, const QRect &rect,
+                                                 QStyle::State state, bool withText = true);
+
+void qt_gtk_test_draw(const QStyle *style, const QGtkTestElement &element, const QStyleOption *option,
+                      QPainter *painter);
+
+QT_END_NAMESPACE
+
+#endif // QGTKTESTELEMENTS_H
@@ -0,0 +1,51 @@
+# Builds the style sources into a test, together with the helpers in
+# this directory, so that tests can reach the style's internals.
+
+include(../../qt6gtk2.pri)
+
+QT += testlib widgets core-private gui-private widgets-private
+CONFIG += testcase no_testcase_installs link_pkgconfig
+CONFIG -= app_bundle
+
+STYLE_DIR = $$PWD/../../src/qt6gtk2-style
+INCLUDEPATH += $$PWD $$STYLE_DIR
+
+DEFINES += QT_NO_ANIMATION
+DEFINES += QT6GTK2_HELPER_PATH=\\\"$$LIBEXECDIR/qt6gtk2-helper\\\"
+DEFINES += QT6GTK2_TEST_GTKRC=\\\"$$PWD/gtkrc\\\"
+
+HEADERS += $$STYLE_DIR/qgtk2painter_p.h \
+           $$STYLE_DIR/qgtkdiskcache_p.h \
+           $$STYLE_DIR/qgtkglobal_p.h \
+           $$STYLE_DIR/qgtkhelperpool_p.h \
+           $$STYLE_DIR/qgtkhelperprotocol_p.h \
+           $$STYLE_DIR/qgtkpixmapcache_p.h \
+           $$STYLE_DIR/qgtkprewarmer_p.h \
+           $$STYLE_DIR/qgtkrenderserver_p.h \
+           $$STYLE_DIR/qgtkscratchpool_p.h \
+           $$STYLE_DIR/qgtksharedcache_p.h \
+           $$STYLE_DIR/qgtkstats_p.h \
+           $$STYLE_DIR/qgtkshmpixmap_p.h \
+           $$STYLE_DIR/qgtkpainter_p.h \
+           $$STYLE_DIR/qgtkstyle_p.h \
+           $$STYLE_DIR/qgtkstyle_p_p.h \
+           $$STYLE_DIR/qstylehelper_p.h \
+           $$PWD/qgtktestelements.h
+SOURCES += $$STYLE_DIR/qgtk2painter.cpp \
+           $$STYLE_DIR/qgtkdiskcache.cpp \
+           $$STYLE_DIR/qgtkhelperpool.cpp \
+           $$STYLE_DIR/qgtkpainter.cpp \
+           $$STYLE_DIR/qgtkpixmapcache.cpp \
+           $$STYLE_DIR/qgtkprewarmer.cpp \
+           $$STYLE_DIR/qgtkrenderserver.cpp \
+           $$STYLE_DIR/qgtkscratchpool.cpp \
+           $$STYLE_DIR/qgtksharedcache.cpp \
+           $$STYLE_DIR/qgtkshmpixmap.cpp \
+           $$STYLE_DIR/qgtkstats.cpp \
+           $$STYLE_DIR/qgtkstyle.cpp \
+           $$STYLE_DIR/qgtkstyle_p.cpp \
+           $$STYLE_DIR/qstylehelper.cpp \
+           $$PWD/qgtktestelements.cpp
+
+PKGCONFIG += gtk+-2.0 x11 xext
+LIBS += -lrt